@@ -0,0 +1,143 @@
+#include "ClusteredLights.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+ClusteredLights::ClusteredLights() {
+	glGenBuffers(1, &lightBuffer);
+	glGenBuffers(1, &clusterBuffer);
+	glGenBuffers(1, &lightIndexBuffer);
+
+	// the buffers are respecified every frame but keep their binding points
+	GLStateCache::get().bindBufferBase(GL_SHADER_STORAGE_BUFFER, LightBinding, lightBuffer);
+	GLStateCache::get().bindBufferBase(GL_SHADER_STORAGE_BUFFER, ClusterBinding, clusterBuffer);
+	GLStateCache::get().bindBufferBase(GL_SHADER_STORAGE_BUFFER, LightIndexBinding, lightIndexBuffer);
+
+	clusters.resize(ClusterCount);
+	setDepthRange(nearPlane, farPlane);
+}
+
+ClusteredLights::~ClusteredLights() {
+	GLuint buffers[] = { lightBuffer, clusterBuffer, lightIndexBuffer };
+	GLStateCache::get().deleteBuffers(3, buffers);
+}
+
+void ClusteredLights::setDepthRange(GLfloat newNearPlane, GLfloat newFarPlane) {
+	nearPlane = newNearPlane;
+	farPlane = newFarPlane;
+
+	// slices grow with distance so near clusters stay small on screen in depth as well
+	sliceScale = (GLfloat)DepthSlices / std::log(farPlane / nearPlane);
+	sliceBias = -std::log(nearPlane) * sliceScale;
+}
+
+GLuint ClusteredLights::DepthSlice(GLfloat depth) const {
+	if (depth <= nearPlane)
+		return 0;
+
+	GLfloat slice = std::log(depth) * sliceScale + sliceBias;
+	return std::min((GLuint)slice, DepthSlices - 1);
+}
+
+// conservative cluster range of a light sphere, false when it lies outside the depth range
+bool ClusteredLights::ClusterBounds(const PointLight& light, const glm::mat4& view, const glm::mat4& projection, glm::uvec3& first, glm::uvec3& last) const {
+	glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(light.PositionRadius), 1.0f));
+	GLfloat radius = light.PositionRadius.w;
+	GLfloat depth = -center.z;
+
+	if (depth + radius < nearPlane || depth - radius > farPlane)
+		return false;
+
+	first.z = DepthSlice(depth - radius);
+	last.z = DepthSlice(depth + radius);
+
+	// a sphere reaching behind the near plane can cover any part of the screen
+	if (depth - radius <= nearPlane) {
+		first.x = 0;
+		first.y = 0;
+		last.x = TilesX - 1;
+		last.y = TilesY - 1;
+		return true;
+	}
+
+	// screen rectangle of the corners of the view space box around the sphere
+	glm::vec2 ndcMin(1.0f);
+	glm::vec2 ndcMax(-1.0f);
+
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+		glm::vec4 clip = projection * glm::vec4(center + offset, 1.0f);
+		glm::vec2 ndc = glm::vec2(clip) / clip.w;
+
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f)
+		return false;
+
+	glm::vec2 tiles((GLfloat)TilesX, (GLfloat)TilesY);
+	glm::vec2 tileMin = glm::clamp((ndcMin * 0.5f + 0.5f) * tiles, glm::vec2(0.0f), tiles - 1.0f);
+	glm::vec2 tileMax = glm::clamp((ndcMax * 0.5f + 0.5f) * tiles, glm::vec2(0.0f), tiles - 1.0f);
+
+	first.x = (GLuint)tileMin.x;
+	first.y = (GLuint)tileMin.y;
+	last.x = (GLuint)tileMax.x;
+	last.y = (GLuint)tileMax.y;
+	return true;
+}
+
+void ClusteredLights::update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection) {
+	lightMin.resize(lights.size());
+	lightMax.resize(lights.size());
+	std::fill(clusters.begin(), clusters.end(), glm::uvec2(0));
+
+	// count the lights of each cluster
+	for (size_t i = 0; i < lights.size(); i++) {
+		if (!ClusterBounds(lights[i], view, projection, lightMin[i], lightMax[i])) {
+			lightMin[i] = glm::uvec3(1);
+			lightMax[i] = glm::uvec3(0);
+			continue;
+		}
+
+		for (GLuint z = lightMin[i].z; z <= lightMax[i].z; z++)
+			for (GLuint y = lightMin[i].y; y <= lightMax[i].y; y++)
+				for (GLuint x = lightMin[i].x; x <= lightMax[i].x; x++)
+					clusters[x + TilesX * (y + TilesY * z)].y++;
+	}
+
+	// turn the counts into offsets, then fill the index list reusing count as the write cursor
+	GLuint offset = 0;
+	for (glm::uvec2& cluster : clusters) {
+		cluster.x = offset;
+		offset += cluster.y;
+		cluster.y = 0;
+	}
+
+	lightIndices.resize(offset);
+
+	for (size_t i = 0; i < lights.size(); i++) {
+		for (GLuint z = lightMin[i].z; z <= lightMax[i].z; z++)
+			for (GLuint y = lightMin[i].y; y <= lightMax[i].y; y++)
+				for (GLuint x = lightMin[i].x; x <= lightMax[i].x; x++) {
+					glm::uvec2& cluster = clusters[x + TilesX * (y + TilesY * z)];
+					lightIndices[cluster.x + cluster.y++] = (GLuint)i;
+				}
+	}
+
+	Upload(lightBuffer, lights.size() * sizeof(PointLight), lights.data());
+	Upload(clusterBuffer, clusters.size() * sizeof(glm::uvec2), clusters.data());
+	Upload(lightIndexBuffer, lightIndices.size() * sizeof(GLuint), lightIndices.data());
+}
+
+// respecify the whole store so the driver does not wait for draws still reading last frame's data
+void ClusteredLights::Upload(GLuint buffer, GLsizeiptr size, const void* data) {
+	GLStateCache::get().bindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+
+	// an empty buffer may not be bound to a storage block, keep one element
+	if (size == 0)
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(PointLight), nullptr, GL_STREAM_DRAW);
+	else
+		glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_STREAM_DRAW);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// point light as stored in the std430 light buffer
+struct PointLight {
+    glm::vec4 PositionRadius;      // world position, radius where the light fades to zero
+    glm::vec4 ColorIntensity;      // color, intensity
+};
+
+// sorts point lights into a view space cluster grid each frame so a fragment only shades the lights near it
+class ClusteredLights {
+
+public:
+    static const GLuint TilesX = 16;           // screen tiles across
+    static const GLuint TilesY = 9;            // screen tiles down
+    static const GLuint DepthSlices = 24;      // exponential depth slices between the near and far plane
+    static const GLuint ClusterCount = TilesX * TilesY * DepthSlices;
+
+    // shader storage binding points read by the lighting shaders
+    static const GLuint LightBinding = 1;
+    static const GLuint ClusterBinding = 2;
+    static const GLuint LightIndexBinding = 3;
+
+    ClusteredLights();
+    ~ClusteredLights();
+
+    // behavior
+    // assign every light to the clusters its sphere touches and upload lights, clusters and index list
+    void update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection);
+
+    // accessors
+    // slice = log(depth) * scale + bias, written to FrameBlock for the fragment shader
+    GLfloat getSliceScale() const { return sliceScale; }
+    GLfloat getSliceBias() const { return sliceBias; }
+    GLuint getLightIndexCount() const { return (GLuint)lightIndices.size(); }
+
+    // mutators
+    void setDepthRange(GLfloat nearPlane, GLfloat farPlane);
+
+private:
+    GLuint lightBuffer = 0;
+    GLuint clusterBuffer = 0;
+    GLuint lightIndexBuffer = 0;
+
+    GLfloat nearPlane = 0.1f;
+    GLfloat farPlane = 100.0f;
+    GLfloat sliceScale = 0.0f;
+    GLfloat sliceBias = 0.0f;
+
+    // kept between frames so building the grid does not allocate
+    std::vector<glm::uvec2> clusters;          // offset into lightIndices, light count
+    std::vector<GLuint> lightIndices;
+    std::vector<glm::uvec3> lightMin;          // first cluster of each light
+    std::vector<glm::uvec3> lightMax;          // last cluster of each light, min > max when culled
+
+    GLuint DepthSlice(GLfloat depth) const;
+    bool ClusterBounds(const PointLight& light, const glm::mat4& view, const glm::mat4& projection, glm::uvec3& first, glm::uvec3& last) const;
+    void Upload(GLuint buffer, GLsizeiptr size, const void* data);
+};
@@ -0,0 +1,213 @@
+#include "GLStateCache.h"
+
+GLStateCache& GLStateCache::get() {
+	static GLStateCache cache;
+	return cache;
+}
+
+GLStateCache::GLStateCache() {
+	for (GLuint unit = 0; unit < MaxTextureUnits; unit++)
+		for (int slot = 0; slot < TextureSlotCount; slot++)
+			textures[unit][slot] = Unknown;
+
+	for (int slot = 0; slot < BufferSlotCount; slot++)
+		buffers[slot] = Unknown;
+
+	for (GLuint index = 0; index < MaxIndexedBindings; index++) {
+		uniformBufferBases[index] = Unknown;
+		storageBufferBases[index] = Unknown;
+	}
+}
+
+int GLStateCache::TextureSlotOf(GLenum target) {
+	switch (target) {
+	case GL_TEXTURE_2D:			return Texture2D;
+	case GL_TEXTURE_2D_ARRAY:	return Texture2DArray;
+	default:					return -1;
+	}
+}
+
+int GLStateCache::BufferSlotOf(GLenum target) {
+	switch (target) {
+	case GL_ARRAY_BUFFER:			return ArrayBuffer;
+	case GL_ELEMENT_ARRAY_BUFFER:	return ElementArrayBuffer;
+	case GL_UNIFORM_BUFFER:			return UniformBuffer;
+	case GL_SHADER_STORAGE_BUFFER:	return ShaderStorageBuffer;
+	case GL_DRAW_INDIRECT_BUFFER:	return DrawIndirectBuffer;
+	case GL_PIXEL_UNPACK_BUFFER:	return PixelUnpackBuffer;
+	default:						return -1;
+	}
+}
+
+// true when value differs from the cached binding, which is then updated
+bool GLStateCache::Changes(GLuint& cached, GLuint value) {
+	if (cached == value) {
+		frameSkipped++;
+		return false;
+	}
+
+	cached = value;
+	frameIssued++;
+	return true;
+}
+
+void GLStateCache::useProgram(GLuint newProgram) {
+	if (Changes(program, newProgram))
+		glUseProgram(newProgram);
+}
+
+void GLStateCache::activeTexture(GLenum unit) {
+	if (Changes(activeUnit, unit - GL_TEXTURE0))
+		glActiveTexture(unit);
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture) {
+	int slot = TextureSlotOf(target);
+
+	// targets or units that are not tracked always go to the driver
+	if (slot < 0 || activeUnit >= MaxTextureUnits) {
+		frameIssued++;
+		glBindTexture(target, texture);
+		return;
+	}
+
+	if (Changes(textures[activeUnit][slot], texture))
+		glBindTexture(target, texture);
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer) {
+	int slot = BufferSlotOf(target);
+
+	if (slot < 0) {
+		frameIssued++;
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (Changes(buffers[slot], buffer))
+		glBindBuffer(target, buffer);
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	GLuint* bases = nullptr;
+	if (target == GL_UNIFORM_BUFFER)
+		bases = uniformBufferBases;
+	else if (target == GL_SHADER_STORAGE_BUFFER)
+		bases = storageBufferBases;
+
+	if (bases == nullptr || index >= MaxIndexedBindings) {
+		frameIssued++;
+		glBindBufferBase(target, index, buffer);
+	}
+	else if (Changes(bases[index], buffer)) {
+		glBindBufferBase(target, index, buffer);
+	}
+	else {
+		return;
+	}
+
+	// binding an indexed point also replaces the generic binding of the target
+	int slot = BufferSlotOf(target);
+	if (slot >= 0)
+		buffers[slot] = buffer;
+}
+
+void GLStateCache::bindVertexArray(GLuint newVao) {
+	if (Changes(vao, newVao)) {
+		glBindVertexArray(newVao);
+
+		// the element buffer binding belongs to the vertex array
+		buffers[ElementArrayBuffer] = Unknown;
+	}
+}
+
+void GLStateCache::enableVertexAttribArray(GLuint index) {
+	GLuint bit = 1u << index;
+	GLuint& enabled = enabledAttributes[vao];
+
+	if (enabled & bit) {
+		frameSkipped++;
+		return;
+	}
+
+	enabled |= bit;
+	frameIssued++;
+	glEnableVertexAttribArray(index);
+}
+
+void GLStateCache::disableVertexAttribArray(GLuint index) {
+	GLuint bit = 1u << index;
+	GLuint& enabled = enabledAttributes[vao];
+
+	if (!(enabled & bit)) {
+		frameSkipped++;
+		return;
+	}
+
+	enabled &= ~bit;
+	frameIssued++;
+	glDisableVertexAttribArray(index);
+}
+
+void GLStateCache::deleteProgram(GLuint deletedProgram) {
+	if (program == deletedProgram)
+		program = Unknown;
+
+	glDeleteProgram(deletedProgram);
+}
+
+void GLStateCache::deleteTextures(GLsizei count, const GLuint* deletedTextures) {
+	for (GLsizei i = 0; i < count; i++)
+		for (GLuint unit = 0; unit < MaxTextureUnits; unit++)
+			for (int slot = 0; slot < TextureSlotCount; slot++)
+				if (textures[unit][slot] == deletedTextures[i])
+					textures[unit][slot] = Unknown;
+
+	glDeleteTextures(count, deletedTextures);
+}
+
+void GLStateCache::deleteBuffers(GLsizei count, const GLuint* deletedBuffers) {
+	for (GLsizei i = 0; i < count; i++) {
+		for (int slot = 0; slot < BufferSlotCount; slot++)
+			if (buffers[slot] == deletedBuffers[i])
+				buffers[slot] = Unknown;
+
+		for (GLuint index = 0; index < MaxIndexedBindings; index++) {
+			if (uniformBufferBases[index] == deletedBuffers[i])
+				uniformBufferBases[index] = Unknown;
+			if (storageBufferBases[index] == deletedBuffers[i])
+				storageBufferBases[index] = Unknown;
+		}
+	}
+
+	glDeleteBuffers(count, deletedBuffers);
+}
+
+void GLStateCache::deleteVertexArrays(GLsizei count, const GLuint* deletedVaos) {
+	for (GLsizei i = 0; i < count; i++) {
+		if (vao == deletedVaos[i])
+			vao = Unknown;
+
+		enabledAttributes.erase(deletedVaos[i]);
+	}
+
+	glDeleteVertexArrays(count, deletedVaos);
+}
+
+void GLStateCache::countUniform(bool uploaded) {
+	if (uploaded)
+		frameUniformUploads++;
+	else
+		frameUniformSkips++;
+}
+
+void GLStateCache::beginFrame() {
+	lastFrameIssued = frameIssued;
+	lastFrameSkipped = frameSkipped;
+	lastFrameUniformUploads = frameUniformUploads;
+	lastFrameUniformSkips = frameUniformSkips;
+	frameIssued = 0;
+	frameSkipped = 0;
+	frameUniformUploads = 0;
+	frameUniformSkips = 0;
+}
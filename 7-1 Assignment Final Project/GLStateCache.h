@@ -0,0 +1,72 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <map>
+
+// shadows the GL binding state so binds that would change nothing never reach the driver
+class GLStateCache {
+
+public:
+    static const GLuint MaxTextureUnits = 16;
+    static const GLuint MaxIndexedBindings = 8;
+
+    // the application has a single GL context, so one cache serves all code
+    static GLStateCache& get();
+
+    // behavior
+    void useProgram(GLuint program);
+    void activeTexture(GLenum unit);
+    void bindTexture(GLenum target, GLuint texture);    // binds on the active unit
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void bindVertexArray(GLuint vao);
+    void enableVertexAttribArray(GLuint index);
+    void disableVertexAttribArray(GLuint index);
+
+    // deleting through the cache forgets the names so a recycled id is bound again
+    void deleteProgram(GLuint program);
+    void deleteTextures(GLsizei count, const GLuint* textures);
+    void deleteBuffers(GLsizei count, const GLuint* buffers);
+    void deleteVertexArrays(GLsizei count, const GLuint* vaos);
+
+    void countUniform(bool uploaded);   // uniform values are filtered by Shader, only counted here
+    void beginFrame();                  // moves the running counters to the last frame counters
+
+    // accessors
+    GLuint getIssuedCalls() const { return lastFrameIssued; }       // calls forwarded to GL last frame
+    GLuint getSkippedCalls() const { return lastFrameSkipped; }     // redundant calls dropped last frame
+    GLuint getUniformUploads() const { return lastFrameUniformUploads; }
+    GLuint getUniformSkips() const { return lastFrameUniformSkips; }
+
+private:
+    static const GLuint Unknown = 0xFFFFFFFF;    // binding not known, the next bind is always issued
+
+    enum TextureSlot { Texture2D = 0, Texture2DArray, TextureSlotCount };
+    enum BufferSlot { ArrayBuffer = 0, ElementArrayBuffer, UniformBuffer, ShaderStorageBuffer, DrawIndirectBuffer, PixelUnpackBuffer, BufferSlotCount };
+
+    GLStateCache();
+
+    static int TextureSlotOf(GLenum target);
+    static int BufferSlotOf(GLenum target);
+
+    bool Changes(GLuint& cached, GLuint value);
+
+    GLuint program = Unknown;
+    GLuint activeUnit = Unknown;                                // index of the active unit, not the GL_TEXTUREi enum
+    GLuint textures[MaxTextureUnits][TextureSlotCount];
+    GLuint buffers[BufferSlotCount];
+    GLuint uniformBufferBases[MaxIndexedBindings];
+    GLuint storageBufferBases[MaxIndexedBindings];
+    GLuint vao = Unknown;
+    std::map<GLuint, GLuint> enabledAttributes;                 // enabled attribute bits per vertex array
+
+    GLuint frameIssued = 0;
+    GLuint frameSkipped = 0;
+    GLuint lastFrameIssued = 0;
+    GLuint lastFrameSkipped = 0;
+    GLuint frameUniformUploads = 0;
+    GLuint frameUniformSkips = 0;
+    GLuint lastFrameUniformUploads = 0;
+    GLuint lastFrameUniformSkips = 0;
+};
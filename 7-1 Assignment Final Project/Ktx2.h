@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// the parts of the KTX2 container the texcook tool writes and the texture loader reads, block compressed 2D
+// textures with a full mip chain and no supercompression
+
+// Vulkan format numbers the container names its blocks by
+enum Ktx2Format : uint32_t {
+    Ktx2FormatBc1RgbUnorm = 131,    // BC1 without alpha, 8 bytes per 4 x 4 block
+    Ktx2FormatBc3Unorm = 137        // BC3, 16 bytes per 4 x 4 block
+};
+
+// width and height every image is cooked to, the size of a texture array layer so the levels copy straight in
+const uint32_t CookedTextureSize = 1024;
+
+const unsigned char Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct Ktx2Header {
+    unsigned char Identifier[12];
+    uint32_t VkFormat;
+    uint32_t TypeSize;              // 1 for block compressed formats
+    uint32_t PixelWidth;
+    uint32_t PixelHeight;
+    uint32_t PixelDepth;            // 0 for 2D textures
+    uint32_t LayerCount;            // 0 when not an array
+    uint32_t FaceCount;             // 1 when not a cube map
+    uint32_t LevelCount;
+    uint32_t SupercompressionScheme;
+    uint32_t DfdByteOffset;         // data format descriptor
+    uint32_t DfdByteLength;
+    uint32_t KvdByteOffset;         // key and value data
+    uint32_t KvdByteLength;
+    uint64_t SgdByteOffset;         // supercompression global data, unused
+    uint64_t SgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must match the KTX2 file layout");
+
+// one per level following the header, level 0 first, while the level data itself is stored smallest level first
+struct Ktx2Level {
+    uint64_t ByteOffset;
+    uint64_t ByteLength;
+    uint64_t UncompressedByteLength;
+};
+static_assert(sizeof(Ktx2Level) == 24, "Ktx2Level must match the KTX2 file layout");
+
+// bytes of one 4 x 4 block of a format the tool writes
+inline uint32_t UKtx2BlockSize(uint32_t vkFormat)
+{
+    return vkFormat == Ktx2FormatBc1RgbUnorm ? 8 : 16;
+}
+
+// header and level index of a whole file in memory, false when it is not a texture the loader can upload
+inline bool UReadKtx2(const unsigned char* data, size_t size, Ktx2Header& header, const Ktx2Level*& levels)
+{
+    if (size < sizeof(Ktx2Header))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.Identifier, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0)
+        return false;
+    if (header.VkFormat != Ktx2FormatBc1RgbUnorm && header.VkFormat != Ktx2FormatBc3Unorm)
+        return false;
+    if (header.PixelWidth == 0 || header.PixelHeight == 0 || header.PixelDepth != 0 || header.LayerCount != 0 || header.FaceCount != 1)
+        return false;
+    if (header.LevelCount == 0 || header.SupercompressionScheme != 0)
+        return false;
+    if (size < sizeof(Ktx2Header) + sizeof(Ktx2Level) * header.LevelCount)
+        return false;
+
+    levels = (const Ktx2Level*)(data + sizeof(Ktx2Header));
+    for (uint32_t i = 0; i < header.LevelCount; i++)
+        if (levels[i].ByteOffset > size || levels[i].ByteLength > size - levels[i].ByteOffset)
+            return false;
+
+    return true;
+}
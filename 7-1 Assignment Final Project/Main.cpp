@@ -3,6 +3,7 @@
 #include <vector>           // import the vector type
 #include <map>              // map
 #include <string>
+#include <random>           // light benchmark placement
 
 #define STB_IMAGE_IMPLEMENTATION  // required for stb_image.h
 #include <stb_image.h>      // image loading header
@@ -16,10 +17,32 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Shader.h"
+#include "ShaderLibrary.h"
+#include "GLStateCache.h"
+#include "ClusteredLights.h"
+#include "PackedVertex.h"
+#include "MeshIndexing.h"
+#include "MeshBuffer.h"
+#include "MeshRegistry.h"
+#include "Scene.h"
+#include "TextureLoader.h"
+#include "TextureArray.h"
+#include "TextureCache.h"
+#include "SceneBatch.h"
+#include "TessellatedBatch.h"
+#include "MeshGeneration.h"
+#include "ThreadPool.h"
 
 using namespace std; // Standard namespace
 
 constexpr auto COLOR_MAP_SIZE = 6;
+constexpr GLuint FRAME_BLOCK_BINDING = 0;   // uniform buffer binding point of FrameBlock in the lighting shaders
+constexpr GLfloat NEAR_PLANE = 0.1f;        // near clip plane, also the start of the light cluster slices
+constexpr GLfloat FAR_PLANE = 100.0f;       // far clip plane, also the end of the light cluster slices
+constexpr GLuint LOD_LEVELS = 5;            // detail levels of the torus and cylinders, each half the segments of the one before
+constexpr GLuint LOD_FINEST_SEGMENTS = 128; // segments around the finest level, the coarsest has 8
+constexpr GLuint TRIANGLE_BUDGET = 500000;  // triangles per frame before every object is pushed to coarser levels
+constexpr GLuint MESH_GENERATOR_VERSION = 1; // part of the mesh cache key, bump when a generator or a literal vertex table changes
 
 // Unnamed namespace
 namespace
@@ -47,74 +70,51 @@ namespace
         WindowProjection ProjectionMode = WindowProjection::Perspective;
     };
 
+    // uniform handles of the lighting program, resolved once after it links
+    struct LightingUniforms {
+        Uniform<GLint> Texture;
+    };
+
+    // CPU copy of the std140 FrameBlock read by the lighting shaders, uploaded once per frame
+    struct FrameUniforms {
+        glm::mat4 View;
+        glm::mat4 Projection;
+        glm::vec3 ViewPosition;
+        GLfloat   Padding0;             // std140 aligns the next struct to 16 bytes
+        glm::vec3 KeyLightPosition;
+        GLfloat   Padding1;             // std140 aligns vec3 to 16 bytes
+        glm::vec3 KeyLightColor;
+        GLfloat   KeyLightIntensity;
+        glm::uvec4 ClusterGrid;         // tiles across, tiles down, depth slices, unused
+        glm::vec4 ClusterDepth;         // depth slice scale and bias, tile width and height in pixels
+    };
+    static_assert(sizeof(FrameUniforms) == 208, "FrameUniforms must match the std140 layout of FrameBlock");
+
     // Stores the GL data relative to a given mesh
     struct GLMesh
     {
-        GLuint vao                      = 0;                     // Handle for the vertex array object
-        GLuint vbos[7]                  = {0, 0, 0, 0, 0, 0, 0}; // Handles for the vertex buffer objects to hold shape data
-        // vertex data 
-        GLuint Mode = GL_TRIANGLES;                 // Default Draw mode, can be overriden in call to draw
-        GLuint AttributeDataType = GL_FLOAT;	    // type of data points, i.e. GL_FLOAT
-        GLuint nTorusVertices           = 0;        // Number of vertices in Torus buffer
-        GLuint nCylinderSideVertices    = 0;        // Number of vertices in Cylinder sides
-        GLuint nCylinderTopOrBottonVertices = 0;    // Number of vertices in Top or Botton cover
-        GLuint nPlaneVertices       = 0;            // Number of vertices in the plane
-        GLuint MatchBoxVertices     = 0;            // Number of vertices in the matchbox
-        GLuint CandleBoxVertices    = 0;            // Number of vertices in the candle box
-        GLuint CandleCylinderSideVertices           = 0;   // Number of vertices in the candle cylinder
-        GLuint CandleCylinderTopOrBottomVertices    = 0;   // Number of vertices in the candle cylinder
-        GLuint SprayBaseCylinderTopOrBottomVertices = 0;   // Number of vertices in the candle cylinder
-        GLuint SprayBaseCylinderSideVertices        = 0;   // Number of vertices in the candle cylinder
-        GLuint SprayTopCylinderTopOrBottomVertices  = 0;   // Number of vertices in the candle cylinder
-        GLuint SprayTopCylinderSideVertices         = 0;   // Number of vertices in the candle cylinder
-        GLuint ValuesPerVertex      = 3;	        // number of values per vertex attribute
-        GLuint ValuesPerColor       = 3;	        // number of values per color attribute
-        GLuint ValuesPerTexture     = 2;	        // number of values per texture attribute
-        GLuint ValuesPerNormal      = 3;	        // number of values per normal attribute
-        // storing different strides allow switching in attributes one shape at a time
-        GLuint PlaneStride              = 11 * sizeof(GLfloat);        // length in bytes between vertices
-        GLuint TorusStride              = 11 * sizeof(GLfloat);        // length in bytes between vertices
-        GLuint CylinderStride           = 11 * sizeof(GLfloat);        // length in bytes between vertices
-        GLuint CandleBoxStride          = 11 * sizeof(GLfloat);        // length in bytes between vertices
-        GLuint MatchBoxStride           = 11 * sizeof(GLfloat);        // length in bytes between vertices
-        GLuint CandleCylinderStride     = 11 * sizeof(GLfloat);        // length in bytes between vertices
-        GLuint SprayCylinderStride      = 11 * sizeof(GLfloat);        // length in bytes between vertices
-        // texture info
-        GLuint CandleHolderTextureId    = 0;	// OpenGL Id of Texture
-        GLuint CandleCylinderTextureId  = 0;	// OpenGL Id of Texture
-        GLuint CandleTextureId          = 0;	// OpenGL Id of Texture
-        GLuint NewsPaperTextureId       = 0;	// OpenGL Id of Texture
-        GLuint CandleBoxTextureId       = 0;	// OpenGL Id of Texture
-        GLuint MatchBoxTextureId        = 0;	// OpenGL Id of Texture
-        GLuint SprayCylinderTextureId   = 0;    // OpenGL Id of Texture
-        int SprayBaseCylinderTextureWidth       = 0;	// Texture Width
-        int SprayBaseCylinderTextureHeight      = 0;	// Texture Height
-        int SprayBaseCylinderTextureChannels    = 0;	// Texture Channels
-        int SprayTopCylinderTextureWidth    = 0;	// Texture Width
-        int SprayTopCylinderTextureHeight   = 0;	// Texture Height
-        int SprayTopCylinderTextureChannels = 0;	// Texture Channels
-        int CandleCylinderTextureWidth    = 0;	// Texture Width
-        int CandleCylinderTextureHeight   = 0;	// Texture Height
-        int CandleCylinderTextureChannels = 0;	// Texture Channels
-        int CandleHolderTextureWidth    = 0;	// Texture Width
-        int CandleHolderTextureHeight   = 0;	// Texture Height
-        int CandleHolderTextureChannels = 0;	// Texture Channels
-        int CandleBoxTextureWidth       = 0;	// Texture Width
-        int CandleBoxTextureHeight      = 0;	// Texture Height
-        int CandleBoxTextureChannels    = 0;	// Texture Channels
-        int MatchBoxTextureWidth        = 0;	// Texture Width
-        int MatchBoxTextureHeight       = 0;	// Texture Height
-        int MatchBoxTextureChannels     = 0;	// Texture Channels
-        int CandleTextureWidth          = 0;	// Texture Width
-        int CandleTextureHeight         = 0;	// Texture Height
-        int CandleTextureChannels       = 0;	// Texture Channels
-        int NewsPaperTextureWidth       = 0;	// Texture Width
-        int NewsPaperTextureHeight      = 0;	// Texture Height
-        int NewsPaperTextureChannels    = 0;	// Texture Channels
+        MeshBuffer* meshBuffer = nullptr;           // shared vertex and index buffer holding every shape
+        MeshRegistry* meshRegistry = nullptr;       // every shape by name with its mesh, texture and bounds
+        TextureLoader* textureLoader = nullptr;     // decodes the shapes' images off the GL thread
+        TextureCache* textureCache = nullptr;       // one texture per image file, the shapes hold references to it
+        TextureArray* textureArray = nullptr;       // the shapes' textures as layers of an array per format, every object draws from one
+        Scene* scene = nullptr;                     // objects and lights read from the scene file
+        std::vector<MeshHandle> sceneShapes;        // registry handle of each shape the scene names
+        SceneBatch* sceneBatch = nullptr;           // objects of the scene and their indirect draw commands
+        TessellatedBatch* tessellatedBatch = nullptr;   // torus and cylinder objects when tessellated on the GPU
+        bool Tessellated = false;                   // --tessellation, no baked torus or cylinder meshes are built
+        bool MeshesCached = false;                  // the mesh buffer was mapped from the mesh cache, nothing is generated
+        MipGeneration TextureMips = MipGeneration::Gpu; // --cpu-mipmaps builds the mip chains on the decoder threads
+        bool CookedTextures = true;                 // --no-cooked-textures decodes the source images even where texcook has cooked them
         // shading programs, different programs can be applied to different shapes
-        Shader* defaultProgram = nullptr;
-        Shader* textureProgram = nullptr;
         Shader* lightingProgram = nullptr;
+        LightingUniforms lightingUniforms;
+        Shader* tessellatedProgram = nullptr;   // the lighting program with tessellation stages
+        LightingUniforms tessellatedUniforms;
+        GLuint frameUbo = 0;                    // uniform buffer holding the per-frame camera and key light
+        // point lights of the scene, clustered every frame
+        std::vector<PointLight> pointLights;
+        ClusteredLights* clusteredLights = nullptr;
     };
 
     struct CameraParams {
@@ -154,25 +154,39 @@ bool UInitialize(WindowParams params, GLFWwindow** window);
 void UResizeWindow(GLFWwindow* window, int width, int height);
 void UProcessInput(GLFWwindow* window);
 void UCreateMesh(GLMesh& mesh);
+void UCreateCylinderIndices(std::vector<GLuint>& indices, GLuint sideVertices, GLuint topOrBottomVertices);
+GLuint UAddListMesh(GLMesh& mesh, const GLfloat* vertices, GLuint vertexCount, const char* shapeName);
 void UDestroyMesh(GLMesh& mesh);
-void URender(GLMesh mesh);
+void URender(GLMesh& mesh);
 void UMouse(GLFWwindow* window, double xpos, double ypos);
 void UScroll(GLFWwindow* window, double xoffset, double yoffset);
-void UCreateTorus(GLMesh& mesh, const GLfloat torusRadius, const GLfloat tubeRadius, const GLuint torusSegments, const GLuint tubePoints);
-void UCreateCylinderSides(const GLuint& cylinderSegments, const float& cylinderSegmentAngleStep, const GLfloat& cylinderRadius, const GLfloat& cylinderHeight, std::vector<GLfloat>& cylinderVertices, const GLfloat& textureXStep);
-void UCreateCylinderTop(std::vector<GLfloat>& cylinderVertices, const GLfloat& cylinderHeight, const GLuint& cylinderSegments, const float& cylinderSegmentAngleStep, const GLfloat& cylinderRadius, const GLfloat& textureXStep);
-void UCreateCylinderBottom(std::vector<GLfloat>& cylinderVertices, const GLfloat& cylinderHeight, const GLuint& cylinderSegments, const float& cylinderSegmentAngleStep, const GLfloat& cylinderRadius, const GLfloat& textureXStep);
-void ULoadTexture(std::string path, GLuint& textureId, int& textureWidth, int& textureHeight, int& textureChannels);
-void DrawSurface(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat specularIntensity);
-void DrawCandleHolders(GLMesh& mesh, glm::mat4 model, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat specularIntensity);
-void DrawVotiveCandles(GLMesh& mesh, glm::mat4 model, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat specularIntensity);
-void DrawCandleBox(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat specularIntensity);
-void DrawMatchBox(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat specularIntensity);
-void DrawCandleCylinder(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat specularIntensity);
-void DrawSprayCylinder(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat specularIntensity);
+void UCreateTorus(GLMesh& mesh, const GLfloat torusRadius, const GLfloat tubeRadius);
+void UGenerateTorus(std::vector<PackedVertex>& torusVertices, std::vector<GLuint>& torusIndices, const GLfloat torusRadius, const GLfloat tubeRadius, const GLuint torusSegments, const GLuint tubePoints, ThreadPool& threadPool = ThreadPool::get());
+void UGenerateCylinder(std::vector<PackedVertex>& cylinderVertices, std::vector<GLuint>& cylinderIndices, const GLfloat cylinderRadius, const GLfloat cylinderHeight, const GLuint cylinderSegments);
+GLuint UCreateCylinderLevels(GLMesh& mesh, const GLfloat cylinderRadius, const GLfloat cylinderHeight, const char* shapeName);
+void UCreateCylinderSides(PackedVertex* sideVertices, const GLuint cylinderSegments, const GLfloat* sines, const GLfloat* cosines, const GLfloat cylinderRadius, const GLfloat cylinderHeight);
+void UCreateCylinderTop(PackedVertex* topVertices, const GLuint cylinderSegments, const GLfloat* sines, const GLfloat* cosines, const GLfloat cylinderRadius, const GLfloat cylinderHeight);
+void UCreateCylinderBottom(PackedVertex* bottomVertices, const GLuint cylinderSegments, const GLfloat* sines, const GLfloat* cosines, const GLfloat cylinderRadius, const GLfloat cylinderHeight);
+void UResolveLightingUniforms(GLMesh& mesh);
+void UCreateFrameUniformBuffer(GLMesh& mesh);
+void UCreatePointLights(GLMesh& mesh);
+void URunLightBenchmark(GLMesh& mesh);
+void UCreateScene(GLMesh& mesh);
+void UAddSceneObjects(GLMesh& mesh);
+void UClearScene(GLMesh& mesh);
+void UUploadScene(GLMesh& mesh);
+void UAddObject(GLMesh& mesh, MeshHandle shape, const ObjectData& object);
+void URunInstanceBenchmark(GLMesh& mesh);
+void URunVertexBenchmark(GLMesh& mesh);
+void URunGenerationBenchmark();
+void URunVertexCacheBenchmark();
+void URunTextureBenchmark(GLMesh& mesh);
+void UUpdateTextures(GLMesh& mesh, bool waitForAll);
+ObjectData UObjectData(const glm::mat4& model, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat highlightSize,
+                       const glm::vec3& fillLightPosition, const glm::vec3& fillLightColor, const GLfloat fillLightIntensity);
 
 // Functioned called to render a frame
-void URender(GLMesh mesh)
+void URender(GLMesh& mesh)
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -183,540 +197,155 @@ void URender(GLMesh mesh)
         gCamera.Up
     );
 
-    glBindVertexArray(mesh.vao);
-
-    // draw newspaper surface upon which the other objects rest
-    DrawSurface(mesh, view, gWindow.Projection, gCamera.Position, 0.1f, 0.4f, 2.0f);
-    
-    // draw box 
-    DrawCandleBox(mesh, view, gWindow.Projection, gCamera.Position, 0.2f, 0.1f, 2.0f);
-    
-    // 1. Scales the object
-    glm::mat4 scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-    // 2. Rotates shape
-    glm::mat4 rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    // 3. move object
-    glm::mat4 translation = glm::translate(glm::vec3(1.0f, 3.0f, 0.3f));
-    // Model matrix: transformations are applied right-to-left order
-    glm::mat4 model = translation * rotation * scale;
-
-    DrawCandleHolders(mesh, model, view, gWindow.Projection, gCamera.Position, 0.1f, 0.8f, 32.0f);
-
-    // no votive inside center holder
-
-    // 1. Scales the object
-    scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-    // 2. Rotates shape
-    rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    // 3. move object
-    translation = glm::translate(glm::vec3(11.0f, 3.0f, 0.3f));
-    // Model matrix: transformations are applied right-to-left order
-    model = translation * rotation * scale;
-
-    DrawCandleHolders(mesh, model, view, gWindow.Projection, gCamera.Position, 0.1f, 0.8f, 32.0f);
-
-    DrawVotiveCandles(mesh, model, view, gWindow.Projection, gCamera.Position, 0.1f, 0.8f, 32.0f);
-
-    // 1. Scales the object
-    scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-    // 2. Rotates shape
-    rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    // 3. move object
-    translation = glm::translate(glm::vec3(-9.0f, 3.0f, 0.3f));
-    // Model matrix: transformations are applied right-to-left order
-    model = translation * rotation * scale;
-
-    // draw the glass candle holders
-    DrawCandleHolders(mesh, model, view, gWindow.Projection, gCamera.Position, 0.1f, 0.8f, 32.0f);
-
-    DrawVotiveCandles(mesh, model, view, gWindow.Projection, gCamera.Position, 0.1f, 0.8f, 32.0f);
+    // camera and key light are shared by every object, upload them once for the frame
+    FrameUniforms frame;
+    frame.View = view;
+    frame.Projection = gWindow.Projection;
+    frame.ViewPosition = gCamera.Position;
+    // key light of the scene
+    const KeyLight& keyLight = mesh.scene->getKeyLight();
+    frame.KeyLightPosition = keyLight.Position;
+    frame.KeyLightColor = keyLight.Color;
+    frame.KeyLightIntensity = keyLight.Intensity;
+
+    // sort the point lights into clusters for this view
+    mesh.clusteredLights->update(mesh.pointLights, view, gWindow.Projection);
+    frame.ClusterGrid = glm::uvec4(ClusteredLights::TilesX, ClusteredLights::TilesY, ClusteredLights::DepthSlices, 0);
+    frame.ClusterDepth = glm::vec4(mesh.clusteredLights->getSliceScale(), mesh.clusteredLights->getSliceBias(),
+        (GLfloat)gWindow.Width / ClusteredLights::TilesX, (GLfloat)gWindow.Height / ClusteredLights::TilesY);
+
+    GLStateCache::get().bindBuffer(GL_UNIFORM_BUFFER, mesh.frameUbo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+
+    // activate shader program, transforms and materials come from the object buffer
+    mesh.lightingProgram->use();
+    mesh.lightingUniforms.Texture.set(0);
 
-    DrawMatchBox(mesh, view, gWindow.Projection, gCamera.Position, 0.1f, 0.8f, 32.0f);
+    // every object of the scene in one indirect multi draw per texture
+    mesh.sceneBatch->update(view, gWindow.Projection, gWindow.Height);
+    mesh.sceneBatch->draw();
 
-    DrawCandleCylinder(mesh, view, gWindow.Projection, gCamera.Position, 0.1f, 1.0f, 128.0f);
+    // torus and cylinders refined on the GPU
+    if (mesh.tessellatedBatch != nullptr) {
+        mesh.tessellatedProgram->use();
+        mesh.tessellatedUniforms.Texture.set(0);
 
-    DrawSprayCylinder(mesh, view, gWindow.Projection, gCamera.Position, 0.1f, 1.0f, 128.0f);
+        mesh.tessellatedBatch->update(gWindow.Projection * view);
+        mesh.tessellatedBatch->draw(gWindow.Width, gWindow.Height);
+    }
 
     // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
     glfwSwapBuffers(gWindow.windowPtr);    // Flips the the back buffer with the front buffer every frame.
 }
 
-void DrawCandleHolders(GLMesh& mesh, glm::mat4 model, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat highlightSize)
+// place every object of the scene in the batch once, the scene does not move so only the camera transforms change per frame
+void UCreateScene(GLMesh& mesh)
 {
-    // Activate the VBOs contained within the mesh's VAO
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[1]);
-    glVertexAttribPointer(0, mesh.ValuesPerVertex, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, 0);
-    glVertexAttribPointer(1, mesh.ValuesPerColor, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)(mesh.ValuesPerVertex * sizeof(float)));
-    glVertexAttribPointer(2, mesh.ValuesPerTexture, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor) * sizeof(float)));
-    glVertexAttribPointer(3, mesh.ValuesPerNormal, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture) * sizeof(float)));
-    glEnableVertexAttribArray(0);     // position
-    glEnableVertexAttribArray(1);     // color
-    glEnableVertexAttribArray(2);     // texture
-    glEnableVertexAttribArray(3);     // normal
-
-    // activate texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, mesh.CandleHolderTextureId); // bind texture id to render unit
-
-    // activate shader program
-    mesh.lightingProgram->use();
-    mesh.lightingProgram->setModelMatrix(model);
-    mesh.lightingProgram->setViewMatrix(view);
-    mesh.lightingProgram->setProjectionMatrix(projection);
-    mesh.lightingProgram->setTextureUnit(0);
-
-    mesh.lightingProgram->setUniformValue("ambientStrength", ambientStrength);      // ambient lighting strength
-    mesh.lightingProgram->setUniformValue("specularIntensity", specularStrength);	// specular lighting strength
-    mesh.lightingProgram->setUniformValue("highlightSize", highlightSize);	        // specular highlight power
-    mesh.lightingProgram->setUniformValue("viewPosition", cameraPos);	            // view position
-
-    // create diffuse lights
-    // key light 
-    //100% yellow 255, 214, 170
-    mesh.lightingProgram->setUniformValue("diffLights[0].position", glm::vec3(10.0f, 25.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].intensity", 1.0f);
-
-    // fill light, not used intensity zero
-    mesh.lightingProgram->setUniformValue("diffLights[1].position", glm::vec3(10.0f, 5.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].intensity", 0.0f);
-
-    // Draws the triangles
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, mesh.nTorusVertices);
-
-    // deactivate program, texture, and vbo
-    glUseProgram(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-}
+    mesh.sceneBatch = new SceneBatch(*mesh.meshBuffer);
+    mesh.sceneBatch->setTriangleBudget(TRIANGLE_BUDGET);
+    if (mesh.Tessellated)
+        mesh.tessellatedBatch = new TessellatedBatch(*mesh.tessellatedProgram);
+
+    // shape names are looked up once, objects refer to them by index
+    for (const string& shape : mesh.scene->getShapes()) {
+        mesh.sceneShapes.push_back(mesh.meshRegistry->find(shape.c_str()));
+        if (mesh.sceneShapes.back() == MeshRegistry::InvalidHandle)
+            cout << "ERROR::SCENE::UNKNOWN_SHAPE " << shape << endl;
+    }
 
-void DrawVotiveCandles(GLMesh& mesh, glm::mat4 model, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat highlightSize)
-{
-    // activate vbo 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[2]);
-    glVertexAttribPointer(0, mesh.ValuesPerVertex, mesh.AttributeDataType, GL_FALSE, mesh.CylinderStride, (GLvoid*)0);
-    glVertexAttribPointer(1, mesh.ValuesPerColor, mesh.AttributeDataType, GL_FALSE, mesh.CylinderStride, (GLvoid*)((mesh.ValuesPerVertex) * sizeof(GLfloat)));
-    glVertexAttribPointer(2, mesh.ValuesPerTexture, mesh.AttributeDataType, GL_FALSE, mesh.CylinderStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor) * sizeof(GLfloat)));
-    glVertexAttribPointer(3, mesh.ValuesPerNormal, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture) * sizeof(GLfloat)));
-    glEnableVertexAttribArray(0);  // position
-    glEnableVertexAttribArray(1);  // color
-    glEnableVertexAttribArray(2);  // texture
-    glEnableVertexAttribArray(3);  // normal
-
-    //activate texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, mesh.CandleTextureId); // bind texture id to render unit
+    UAddSceneObjects(mesh);
+    UUploadScene(mesh);
 
-    mesh.lightingProgram->use();
-    mesh.lightingProgram->setModelMatrix(model);
-    mesh.lightingProgram->setViewMatrix(view);
-    mesh.lightingProgram->setProjectionMatrix(gWindow.Projection);
-    mesh.lightingProgram->setTextureUnit(0);
-
-    mesh.lightingProgram->setUniformValue("ambientStrength", ambientStrength);      // ambient lighting strength
-    mesh.lightingProgram->setUniformValue("specularIntensity", specularStrength);	// specular lighting strength
-    mesh.lightingProgram->setUniformValue("highlightSize", highlightSize);	        // specular highlight power
-    mesh.lightingProgram->setUniformValue("viewPosition", cameraPos);	            // view position  
-
-    // create diffuse lights
-    // key light 
-    //100% yellow 255, 214, 170
-    mesh.lightingProgram->setUniformValue("diffLights[0].position", glm::vec3(10.0f, 25.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].intensity", 1.0f);
-
-    // activate fill light for candle, key light made surface look wrong
-    mesh.lightingProgram->setUniformValue("diffLights[1].position", glm::vec3(10.0f, 5.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].color", glm::vec3(1.0f, 1.0f, 1.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].intensity", 1.0f);
-
-    // cylinder sides
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, mesh.nCylinderSideVertices); // Draws the triangle
-
-    // cylinder top
-    glDrawArrays(GL_TRIANGLE_FAN, mesh.nCylinderSideVertices, mesh.nCylinderTopOrBottonVertices); // Draws the triangle
-
-    // cylinder bottom
-    glDrawArrays(GL_TRIANGLE_FAN, mesh.nCylinderSideVertices + mesh.nCylinderTopOrBottonVertices, mesh.nCylinderTopOrBottonVertices); // Draws the triangle
-
-    // deactivate program, texture, and vbo
-    glUseProgram(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-}
+    cout << "INFO: Scene of " << mesh.sceneBatch->getObjectCount() << " objects over " << mesh.meshBuffer->getVertexCount() << " vertices and "
+         << mesh.meshBuffer->getIndexCount() << " indices of every detail level" << endl;
 
-void DrawCandleBox(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat highlightSize)
-{
-    // 1. Scales the object
-    glm::mat4 scale = glm::scale(glm::vec3(2.5f, 2.0f, 2.5f));
-    // 2. Rotates shape
-    glm::mat4 rotation = glm::rotate(glm::radians(0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    // 3. move object
-    glm::mat4 translation = glm::translate(glm::vec3(-15.3f, -1.5f, -6.0f));
-    // Model matrix: transformations are applied right-to-left order
-    glm::mat4 model = translation * rotation * scale;
-
-    // activate vbo 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[3]);
-    glVertexAttribPointer(0, mesh.ValuesPerVertex, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, 0);
-    glVertexAttribPointer(1, mesh.ValuesPerColor, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)(mesh.ValuesPerVertex * sizeof(float)));
-    glVertexAttribPointer(2, mesh.ValuesPerTexture, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor) * sizeof(float)));
-    glVertexAttribPointer(3, mesh.ValuesPerNormal, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture) * sizeof(float)));
-    glEnableVertexAttribArray(0);     // position
-    glEnableVertexAttribArray(1);     // color
-    glEnableVertexAttribArray(2);     // texture
-    glEnableVertexAttribArray(3);     // normal
-
-    // activate texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, mesh.CandleBoxTextureId); // bind texture id to render unit
-
-    // activate shader program
-    mesh.lightingProgram->use();
-    mesh.lightingProgram->setModelMatrix(model);
-    mesh.lightingProgram->setViewMatrix(view);
-    mesh.lightingProgram->setProjectionMatrix(gWindow.Projection);
-    mesh.lightingProgram->setTextureUnit(0);
-
-    mesh.lightingProgram->setUniformValue("ambientStrength", ambientStrength);      // ambient lighting strength
-    mesh.lightingProgram->setUniformValue("specularIntensity", specularStrength);	// specular lighting strength
-    mesh.lightingProgram->setUniformValue("highlightSize", highlightSize);	        // specular highlight power
-    mesh.lightingProgram->setUniformValue("viewPosition", cameraPos);	            // view position
-
-    // create diffuse lights
-    // key light 
-    //100% yellow 255, 214, 170
-    mesh.lightingProgram->setUniformValue("diffLights[0].position", glm::vec3(10.0f, 25.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].intensity", 1.0f);
-
-    // fill light, not used intensity zero
-    mesh.lightingProgram->setUniformValue("diffLights[1].position", glm::vec3(10.0f, 5.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].intensity", 0.0f);
-
-    // draw shape
-    glDrawArrays(GL_TRIANGLES, 0, mesh.CandleBoxVertices);
-
-    // deactivate program, texture and vbo
-    glUseProgram(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (mesh.tessellatedBatch != nullptr)
+        cout << "INFO: " << mesh.tessellatedBatch->getObjectCount() << " of them tessellated on the GPU from "
+             << mesh.tessellatedBatch->getPatchCount() << " patches" << endl;
 }
 
-void DrawMatchBox(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat highlightSize)
+void UClearScene(GLMesh& mesh)
 {
-    // 1. Scales the object
-    glm::mat4 scale = glm::scale(glm::vec3(2.6f, 1.5f, 3.0f));
-    // 2. Rotates shape
-    glm::mat4 rotation = glm::rotate(glm::radians(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    // 3. move object
-    glm::mat4 translation = glm::translate(glm::vec3(10.0f, -1.5f, 10.0f));
-    // Model matrix: transformations are applied right-to-left order
-    glm::mat4 model = translation * rotation * scale;
-
-    // activate vbo 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[4]);
-    glVertexAttribPointer(0, mesh.ValuesPerVertex, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, 0);
-    glVertexAttribPointer(1, mesh.ValuesPerColor, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)(mesh.ValuesPerVertex * sizeof(float)));
-    glVertexAttribPointer(2, mesh.ValuesPerTexture, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor) * sizeof(float)));
-    glVertexAttribPointer(3, mesh.ValuesPerNormal, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture) * sizeof(float)));
-    glEnableVertexAttribArray(0);     // position
-    glEnableVertexAttribArray(1);     // color
-    glEnableVertexAttribArray(2);     // texture
-    glEnableVertexAttribArray(3);     // normal
-
-    // activate texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, mesh.MatchBoxTextureId); // bind texture id to render unit
-
-    // activate shader program
-    mesh.lightingProgram->use();
-    mesh.lightingProgram->setModelMatrix(model);
-    mesh.lightingProgram->setViewMatrix(view);
-    mesh.lightingProgram->setProjectionMatrix(gWindow.Projection);
-    mesh.lightingProgram->setTextureUnit(0);
-
-    mesh.lightingProgram->setUniformValue("ambientStrength", ambientStrength);      // ambient lighting strength
-    mesh.lightingProgram->setUniformValue("specularIntensity", specularStrength);	// specular lighting strength
-    mesh.lightingProgram->setUniformValue("highlightSize", highlightSize);	        // specular highlight power
-    mesh.lightingProgram->setUniformValue("viewPosition", cameraPos);	            // view position
- 
-    // create diffuse lights
-    // key light 
-    //100% yellow 255, 214, 170
-    mesh.lightingProgram->setUniformValue("diffLights[0].position", glm::vec3(10.0f, 25.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].intensity", 1.0f);
-
-    // fill light, not used intensity zero
-    mesh.lightingProgram->setUniformValue("diffLights[1].position", glm::vec3(10.0f, 5.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].intensity", 0.0f);
-
-
-    // draw shape
-    glDrawArrays(GL_TRIANGLES, 0, mesh.MatchBoxVertices);
-
-    // deactivate program, texture and vbo
-    glUseProgram(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mesh.sceneBatch->clear();
+    if (mesh.tessellatedBatch != nullptr)
+        mesh.tessellatedBatch->clear();
 }
 
-void DrawCandleCylinder(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat highlightSize)
+void UUploadScene(GLMesh& mesh)
 {
-    // 1. Scales the object
-    glm::mat4 scale = glm::scale(glm::vec3(2.0f, 2.0f, 3.0f));
-    // 2. Rotates shape
-    glm::mat4 rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    // 3. move object
-    glm::mat4 translation = glm::translate(glm::vec3(0.0f, 0.0f, 13.0f));
-    // Model matrix: transformations are applied right-to-left order
-    glm::mat4 model = translation * rotation * scale;
-
-    // activate texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, mesh.CandleCylinderTextureId); // bind texture id to render unit
-
-    // activate vbo 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[5]);
-    glVertexAttribPointer(0, mesh.ValuesPerVertex, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, 0);
-    glVertexAttribPointer(1, mesh.ValuesPerColor, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)(mesh.ValuesPerVertex * sizeof(float)));
-    glVertexAttribPointer(2, mesh.ValuesPerTexture, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor) * sizeof(float)));
-    glVertexAttribPointer(3, mesh.ValuesPerNormal, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture) * sizeof(float)));
-    glEnableVertexAttribArray(0);     // position
-    glEnableVertexAttribArray(1);     // color
-    glEnableVertexAttribArray(2);     // texture
-    glEnableVertexAttribArray(3);     // normal
-
-    // activate shader program
-    mesh.lightingProgram->use();
-    mesh.lightingProgram->setModelMatrix(model);
-    mesh.lightingProgram->setViewMatrix(view);
-    mesh.lightingProgram->setProjectionMatrix(gWindow.Projection);
-    mesh.lightingProgram->setTextureUnit(0);
-
-    mesh.lightingProgram->setUniformValue("ambientStrength", ambientStrength);      // ambient lighting strength
-    mesh.lightingProgram->setUniformValue("specularIntensity", specularStrength);	// specular lighting strength
-    mesh.lightingProgram->setUniformValue("highlightSize", highlightSize);	        // specular highlight power
-    mesh.lightingProgram->setUniformValue("viewPosition", cameraPos);	            // view position
-
-    // create diffuse lights
-    // key light 
-    //100% yellow 255, 214, 170
-    mesh.lightingProgram->setUniformValue("diffLights[0].position", glm::vec3(10.0f, 25.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].intensity", 1.0f);
-
-    // fill light, not used intensity zero
-    mesh.lightingProgram->setUniformValue("diffLights[1].position", glm::vec3(0.0f, 7.0f, 11.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].intensity", 0.3f);
-
-    // draw shape
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, mesh.CandleCylinderSideVertices);
-
-    // cylinder top
-    glDrawArrays(GL_TRIANGLE_FAN, mesh.CandleCylinderSideVertices, mesh.CandleCylinderTopOrBottomVertices); // Draws the triangle
-
-    // cylinder bottom
-    glDrawArrays(GL_TRIANGLE_FAN, mesh.CandleCylinderSideVertices + mesh.CandleCylinderTopOrBottomVertices, mesh.CandleCylinderTopOrBottomVertices); // Draws the triangle
-
-    // deactivate program, texture and vbo
-    glUseProgram(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mesh.sceneBatch->upload();
+    if (mesh.tessellatedBatch != nullptr)
+        mesh.tessellatedBatch->upload();
 }
 
-void DrawSprayCylinder(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat highlightSize)
+// place one object of a registered shape, the torus and cylinders go to the tessellated batch when it is used,
+// everything else and the baked levels of detail to the scene batch
+// every object samples the texture array its shape's texture is a layer of, its material names the layer
+void UAddObject(GLMesh& mesh, MeshHandle shape, const ObjectData& object)
 {
-    // 1. Scales the object
-    glm::mat4 scale = glm::scale(glm::vec3(0.8f, 0.8f, 6.0f));
-    // 2. Rotates shape
-    glm::mat4 rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    // 3. move object
-    glm::mat4 translation = glm::translate(glm::vec3(-10.0f, 1.5f, 10.0f));
-    // Model matrix: transformations are applied right-to-left order
-    glm::mat4 model = translation * rotation * scale;
-
-    // activate texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, mesh.SprayCylinderTextureId); // bind texture id to render unit
-
-    // activate vbo 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[5]);
-    glVertexAttribPointer(0, mesh.ValuesPerVertex, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, 0);
-    glVertexAttribPointer(1, mesh.ValuesPerColor, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)(mesh.ValuesPerVertex * sizeof(float)));
-    glVertexAttribPointer(2, mesh.ValuesPerTexture, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor) * sizeof(float)));
-    glVertexAttribPointer(3, mesh.ValuesPerNormal, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture) * sizeof(float)));
-    glEnableVertexAttribArray(0);     // position
-    glEnableVertexAttribArray(1);     // color
-    glEnableVertexAttribArray(2);     // texture
-    glEnableVertexAttribArray(3);     // normal
- 
-    // activate shader program
-    mesh.lightingProgram->use();
-    mesh.lightingProgram->setModelMatrix(model);
-    mesh.lightingProgram->setViewMatrix(view);
-    mesh.lightingProgram->setProjectionMatrix(gWindow.Projection);
-    mesh.lightingProgram->setTextureUnit(0);
-
-    mesh.lightingProgram->setUniformValue("ambientStrength", ambientStrength);      // ambient lighting strength
-    mesh.lightingProgram->setUniformValue("specularIntensity", specularStrength);	// specular lighting strength
-    mesh.lightingProgram->setUniformValue("highlightSize", highlightSize);	        // specular highlight power
-    mesh.lightingProgram->setUniformValue("viewPosition", cameraPos);	            // view position
-
-    // create diffuse lights
-    // key light 
-    //100% yellow 255, 214, 170
-    mesh.lightingProgram->setUniformValue("diffLights[0].position", glm::vec3(10.0f, 25.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].intensity", 1.0f);
-
-    // fill light, not used intensity zero
-    mesh.lightingProgram->setUniformValue("diffLights[1].position", glm::vec3(-10.0f, 8.0f, 10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].intensity", 0.3f);
-
-    GLint offset = 0;
+    const MeshRegistry& registry = *mesh.meshRegistry;
+    const TextureSlot slot = registry.getTexture(shape);
+    const GLuint textureArray = mesh.textureArray->getTexture(slot);
 
-    // draw shape
-    glDrawArrays(GL_TRIANGLE_STRIP, offset, mesh.CandleCylinderSideVertices);      // Draws the triangle
+    ObjectData layered = object;
+    layered.Material.w = (GLfloat)TextureArray::getLayer(slot);
 
-    offset = mesh.CandleCylinderSideVertices;
-
-    // cylinder top
-    glDrawArrays(GL_TRIANGLE_FAN, offset, mesh.CandleCylinderTopOrBottomVertices); // Draws the triangle
-
-    offset += mesh.CandleCylinderTopOrBottomVertices;
-
-    // cylinder bottom
-    glDrawArrays(GL_TRIANGLE_FAN, offset, mesh.CandleCylinderTopOrBottomVertices); // Draws the triangle
-
-    offset += mesh.CandleCylinderTopOrBottomVertices;
-
-
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-
-    // 1. Scales the object
-    scale = glm::scale(glm::vec3(0.5f, 0.5f, 2.5f));
-    // 2. Rotates shape
-    rotation = glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    // 3. move object
-    translation = glm::translate(glm::vec3(-10.0f, 5.8f, 10.0f));
-    // Model matrix: transformations are applied right-to-left order
-    model = translation * rotation * scale;
-
-    // activate shader program
-    mesh.lightingProgram->use();
-    mesh.lightingProgram->setModelMatrix(model);
-    mesh.lightingProgram->setViewMatrix(view);
-    mesh.lightingProgram->setProjectionMatrix(gWindow.Projection);
-    mesh.lightingProgram->setTextureUnit(0);
-
-    mesh.lightingProgram->setUniformValue("ambientStrength", ambientStrength);      // ambient lighting strength
-    mesh.lightingProgram->setUniformValue("specularIntensity", specularStrength);	// specular lighting strength
-    mesh.lightingProgram->setUniformValue("highlightSize", highlightSize);	        // specular highlight power
-    mesh.lightingProgram->setUniformValue("viewPosition", cameraPos);	            // view position
-
-    // create diffuse lights
-    // key light 
-    //100% yellow 255, 214, 170
-    mesh.lightingProgram->setUniformValue("diffLights[0].position", glm::vec3(10.0f, 25.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].intensity", 1.0f);
-
-    // fill light, not used intensity zero
-    mesh.lightingProgram->setUniformValue("diffLights[1].position", glm::vec3(10.0f, 5.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].intensity", 0.0f);
-
-    offset = 0;
-
-    // draw shape
-    glDrawArrays(GL_TRIANGLE_STRIP, offset, mesh.CandleCylinderSideVertices);      // Draws the triangle
-
-    offset = mesh.CandleCylinderSideVertices;
-
-    // cylinder top
-    glDrawArrays(GL_TRIANGLE_FAN, offset, mesh.CandleCylinderTopOrBottomVertices); // Draws the triangle
-
-    offset += mesh.CandleCylinderTopOrBottomVertices;
+    if (mesh.tessellatedBatch != nullptr && registry.isParametric(shape))
+        mesh.tessellatedBatch->add(registry.getSurface(shape), registry.getSurfaceSize(shape), textureArray, layered);
+    else
+        mesh.sceneBatch->add(registry.getMesh(shape), textureArray, layered);
+}
 
-    // cylinder bottom
-    glDrawArrays(GL_TRIANGLE_FAN, offset, mesh.CandleCylinderTopOrBottomVertices); // Draws the triangle
+// uploads the images decoded since the last frame into their layers of the texture arrays, or waits for every one
+// still pending
+void UUpdateTextures(GLMesh& mesh, bool waitForAll)
+{
+    GLuint pendingCount = mesh.textureLoader->getPendingCount();
+
+    if (waitForAll)
+        mesh.textureLoader->finish();
+    else
+        mesh.textureLoader->update();
+
+    // reported once, when the last image is resident
+    if (pendingCount > 0 && mesh.textureLoader->getPendingCount() == 0) {
+        const TextureCache& cache = *mesh.textureCache;
+        cout << "INFO: " << cache.getTextureCount() << " textures for " << cache.getReferenceCount() << " references, "
+             << cache.getResidentSize() / 1024 << " KB of layers resident, " << cache.getSharedCount() << " shared saving "
+             << cache.getSharedSize() / 1024 << " KB" << endl;
+    }
+}
 
-    offset += mesh.CandleCylinderTopOrBottomVertices;
+// place every object of the scene file, objects of a shape the program does not build are skipped
+void UAddSceneObjects(GLMesh& mesh)
+{
+    const vector<MeshHandle>& shapes = mesh.sceneShapes;
 
-    glPopMatrix();
+    for (const SceneObject& object : mesh.scene->getObjects()) {
+        if (shapes[object.Shape] == MeshRegistry::InvalidHandle)
+            continue;
 
-    // deactivate program, texture, and vbo
-    glUseProgram(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+        UAddObject(mesh, shapes[object.Shape], UObjectData(mesh.scene->getModel(object), object.Material.x, object.Material.y, object.Material.z,
+            glm::vec3(object.FillLight), object.FillLightColor, object.FillLight.w));
+    }
 }
 
-
-void DrawSurface(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 cameraPos, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat highlightSize)
+// values of one object in the object buffer
+ObjectData UObjectData(const glm::mat4& model, const GLfloat ambientStrength, const GLfloat specularStrength, const GLfloat highlightSize,
+                       const glm::vec3& fillLightPosition, const glm::vec3& fillLightColor, const GLfloat fillLightIntensity)
 {
-    // 1. Scales the object
-    glm::mat4 scale = glm::scale(glm::vec3(30.0f, 1.0f, 20.0f));
-    // 2. Rotates shape
-    glm::mat4 rotation = glm::rotate(glm::radians(0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    // 3. move object
-    glm::mat4 translation = glm::translate(glm::vec3(0.0f, -1.5f, 0.0f));
-    // Model matrix: transformations are applied right-to-left order
-    glm::mat4 model = translation * rotation * scale;
-
-    // activate vbo 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
-    glVertexAttribPointer(0, mesh.ValuesPerVertex, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, 0);
-    glVertexAttribPointer(1, mesh.ValuesPerColor, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)(mesh.ValuesPerVertex * sizeof(float)));
-    glVertexAttribPointer(2, mesh.ValuesPerTexture, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor) * sizeof(float)));
-    glVertexAttribPointer(3, mesh.ValuesPerNormal, mesh.AttributeDataType, GL_FALSE, mesh.PlaneStride, (GLvoid*)((mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture) * sizeof(float)));
-    glEnableVertexAttribArray(0);     // position
-    glEnableVertexAttribArray(1);     // color
-    glEnableVertexAttribArray(2);     // texture
-    glEnableVertexAttribArray(3);     // normal
-
-    // activate texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, mesh.NewsPaperTextureId); // bind texture id to render unit
-
-    // activate shader program
-    mesh.lightingProgram->use();
-    mesh.lightingProgram->setModelMatrix(model);
-    mesh.lightingProgram->setViewMatrix(view);
-    mesh.lightingProgram->setProjectionMatrix(gWindow.Projection);
-    mesh.lightingProgram->setTextureUnit(0);
-
-    mesh.lightingProgram->setUniformValue("ambientStrength", ambientStrength);      // ambient lighting strength
-    mesh.lightingProgram->setUniformValue("specularIntensity", specularStrength);	// specular lighting strength
-    mesh.lightingProgram->setUniformValue("highlightSize", highlightSize);	        // specular highlight power
-    mesh.lightingProgram->setUniformValue("viewPosition", cameraPos);	            // view position
-
-    // create diffuse lights
-    // key light 
-    //100% yellow 255, 214, 170
-    mesh.lightingProgram->setUniformValue("diffLights[0].position", glm::vec3(10.0f, 25.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[0].intensity", 1.0f);
-
-    // fill light, not used intensity zero
-    mesh.lightingProgram->setUniformValue("diffLights[1].position", glm::vec3(10.0f, 5.0f, -10.0f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].color", glm::vec3(1.0f, 0.839215686f, 0.666666667f));
-    mesh.lightingProgram->setUniformValue("diffLights[1].intensity", 0.0f);
-
-    // draw shape
-    glDrawArrays(GL_TRIANGLES, 0, mesh.nPlaneVertices);
-
-    // deactivate program, texture, and vbo
-    glUseProgram(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    ObjectData object;
+    object.Model = model;
+
+    // normals need the inverse transpose to stay perpendicular under non-uniform scale
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+    for (int column = 0; column < 3; column++)
+        object.NormalMatrix[column] = glm::vec4(normalMatrix[column], 0.0f);
+
+    object.Material = glm::vec4(ambientStrength, specularStrength, highlightSize, 0.0f);
+    object.FillLightPosition = glm::vec4(fillLightPosition, fillLightIntensity);
+    object.FillLightColor = glm::vec4(fillLightColor, 0.0f);
+    return object;
 }
 
 // create torus
@@ -724,7 +353,7 @@ void DrawSurface(GLMesh& mesh, glm::mat4 view, glm::mat4 projection, glm::vec3 c
 // number of points around tube
 // radius (R) of torus
 // radius (r) of tube around torus
-void UCreateTorus(GLMesh& mesh, const GLfloat torusRadius, const GLfloat tubeRadius, const GLuint torusSegments, const GLuint tubePoints) {
+void UGenerateTorus(std::vector<PackedVertex>& torusVertices, std::vector<GLuint>& torusIndices, const GLfloat torusRadius, const GLfloat tubeRadius, const GLuint torusSegments, const GLuint tubePoints, ThreadPool& threadPool) {
 
     // A torus is given by the paramteric equations:
     // x = (R + r cos(v))cos(u)
@@ -732,322 +361,230 @@ void UCreateTorus(GLMesh& mesh, const GLfloat torusRadius, const GLfloat tubeRad
     // z = r sin(v)
     // u, v => [0, 2pi]
 
-    const float torusSegmentAngleStep = glm::two_pi<float>() / torusSegments;   // calculate angle in radians to increment by
-    const float tubeAngleStep = glm::two_pi<float>() / tubePoints;             // calculate angle in radians to increment by
-
-    // Position, Color, texture data
-    vector<GLfloat> torusVertices;  // temporary buffer to hold vertex attributes
-
-    // create vertex position and color attributes
-    for (size_t i = 0; i < torusSegments; i++) { // iterate segments around torus
-
-        const float currentSegmentAngle = i * torusSegmentAngleStep;  // current angle (u) for around torus
+    // every ring has the same tube angles, so sine and cosine are evaluated once per ring and once per tube point
+    vector<GLfloat> ringSines, ringCosines, tubeSines, tubeCosines;
+    USinCosTable(torusSegments, ringSines, ringCosines);
+    USinCosTable(tubePoints, tubeSines, tubeCosines);
 
-        // calculate sine and cosine of main seqment angle
-        for (size_t j = 0; j <= tubePoints; j++) { // iterate points around tube at segment
-        
-            const float currentTubeAngle = j * tubeAngleStep; // current angle (v) around tube
+    // a grid shared by the segments on either side of each ring, the last ring repeats the first with u = 2pi
+    const GLuint ringVertices = tubePoints + 1;
+    const GLuint ringIndices = tubePoints * 6;
+    torusVertices.resize((torusSegments + 1) * ringVertices);
+    torusIndices.resize(torusSegments * ringIndices);
 
-            const float sinTubePoint = sin(currentTubeAngle);
-            const float cosTubePoint = cos(currentTubeAngle);
+    PackedVertex* vertexOutput = torusVertices.data();
+    GLuint* indexOutput = torusIndices.data();
 
-            for (size_t k = 0; k < 2; k++) { // for the triangle strip compute current and then next position
+    // rings are independent, each thread fills its own rings of the preallocated buffers
+    threadPool.parallelFor(torusSegments + 1, [&](GLuint firstRing, GLuint lastRing) {
+        for (GLuint i = firstRing; i < lastRing; i++) { // iterate rings around torus
+            PackedVertex* ring = vertexOutput + i * ringVertices;
 
-                const float u_2 = currentSegmentAngle + (k * torusSegmentAngleStep);
-                const float x = (torusRadius + (tubeRadius * cosTubePoint)) * cos(u_2);
-                const float y = (torusRadius + (tubeRadius * cosTubePoint)) * sin(u_2);
-                const float z = tubeRadius * sinTubePoint;
+            for (GLuint j = 0; j <= tubePoints; j++) { // iterate points around tube at segment
+                const float ringRadius = torusRadius + tubeRadius * tubeCosines[j];
 
-                torusVertices.push_back(x); // position x
-                torusVertices.push_back(y); // position y
-                torusVertices.push_back(z); // position z
+                const float x = ringRadius * ringCosines[i];
+                const float y = ringRadius * ringSines[i];
+                const float z = tubeRadius * tubeSines[j];
 
                 // color isn't needed because of textures, only included for testing purposes
                 const glm::vec3 color = gColorMap[j % COLOR_MAP_SIZE];
 
-                torusVertices.push_back(color.r); // red
-                torusVertices.push_back(color.g); // green
-                torusVertices.push_back(color.b); // blue
+                // texture coordinates run once around the torus and once around the tube
+                const glm::vec2 textureCoord((float)i / torusSegments, (float)j / tubePoints);
 
-                // texture coordinates
-                // compute texture coords
-                float textureXCoord = u_2 / glm::two_pi<float>();
-                float textureYCoord = currentTubeAngle / glm::two_pi<float>();
+                // compute normal
+                const glm::vec3 normal(tubeCosines[j] * ringCosines[i], tubeCosines[j] * ringSines[i], tubeSines[j]);
 
-                if (textureXCoord > 1.0f)
-                    textureXCoord = 1.0f;
-                if (textureYCoord > 1.0f)
-                    textureYCoord = 1.0f;
-
-                // add tex coords
-                torusVertices.push_back(textureXCoord);
-                torusVertices.push_back(textureYCoord);
-
-                // compute normal 
-                float normalX = cos(currentTubeAngle) * cos(u_2);
-                float normalY = cos(currentTubeAngle) * sin(u_2);
-                float normalZ = sin(currentTubeAngle);
+                ring[j] = UPackVertex(glm::vec3(x, y, z), color, textureCoord, normal);
+            }
 
-                torusVertices.push_back(normalX);
-                torusVertices.push_back(normalY);
-                torusVertices.push_back(normalZ);
+            if (i == torusSegments)
+                continue;
+
+            // two triangles per grid cell to the next ring, wound the way the old triangle strip wound them
+            GLuint* cell = indexOutput + i * ringIndices;
+            for (GLuint j = 0; j < tubePoints; j++, cell += 6) {
+                GLuint current = i * ringVertices + j;      // (u, v)
+                GLuint next = current + ringVertices;       // (u + step, v)
+
+                cell[0] = current;
+                cell[1] = next;
+                cell[2] = current + 1;
+                cell[3] = current + 1;
+                cell[4] = next;
+                cell[5] = next + 1;
             }
         }
-    }
-    mesh.TorusStride = sizeof(GLfloat) * (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal);
-    mesh.nTorusVertices = torusVertices.size() / (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal); // number of torusVertices to render
+    });
+}
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * torusVertices.size(), torusVertices.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
+// create the candle holder torus, one detail level per halving of the segments
+void UCreateTorus(GLMesh& mesh, const GLfloat torusRadius, const GLfloat tubeRadius) {
+    GLuint torusMesh = MeshBuffer::InvalidMesh;
 
-    // load texture 
-    stbi_set_flip_vertically_on_load(true);
-    ULoadTexture("Data\\pexels-hoang-le-978462.jpg", mesh.CandleHolderTextureId, mesh.CandleHolderTextureWidth, mesh.CandleHolderTextureHeight, mesh.CandleHolderTextureChannels);
+    // a cached buffer already holds every level
+    if (mesh.MeshesCached && !mesh.Tessellated)
+        torusMesh = mesh.meshBuffer->findMesh("torus");
 
-    torusVertices.clear();
-}
+    // tessellated on the GPU there are no baked levels
+    for (GLuint level = 0; level < LOD_LEVELS && !mesh.Tessellated && !mesh.MeshesCached; level++) {
+        const GLuint segments = LOD_FINEST_SEGMENTS >> level;   // same count around the ring and around the tube
 
-// create cylinder
-void UCreateCylinder(GLMesh& mesh, const GLfloat cylinderRadius, const GLfloat cylinderHeight, const GLuint cylinderSegments) {
-    vector<GLfloat> cylinderVertices;  // temporary buffer to hold both position and color data
+        // Position, Color, texture data
+        vector<PackedVertex> torusVertices;  // temporary buffer to hold vertex attributes
+        vector<GLuint> torusIndices;
 
-    const auto cylinderSegmentAngleStep = (2 * glm::pi<float>()) / (float)cylinderSegments;  // calculate angle in radians to increment by
- 
-    GLfloat textureXStep = 1.0f / cylinderSegments;
+        UGenerateTorus(torusVertices, torusIndices, torusRadius, tubeRadius, segments, segments);
+        UOptimizeVertexCache(torusIndices, torusVertices.size());
 
-    UCreateCylinderSides(cylinderSegments, cylinderSegmentAngleStep, cylinderRadius, cylinderHeight, cylinderVertices, textureXStep);
+        // Stages the vertices for the shared buffer
+        if (level == 0)
+            torusMesh = mesh.meshBuffer->addMesh(torusVertices, torusIndices, "torus");
+        else
+            mesh.meshBuffer->addLevel(torusMesh, torusVertices, torusIndices);
+    }
+
+    TextureSlot texture = mesh.textureCache->acquire("Data\\pexels-hoang-le-978462.jpg", TextureFiltering::Trilinear);
 
-    mesh.CylinderStride = sizeof(GLfloat) * (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal);
-    mesh.nCylinderSideVertices = cylinderVertices.size() / (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal); // number of torusVertices to render
+    mesh.meshRegistry->addParametric("torus", torusMesh, texture, ParametricSurface::Torus, glm::vec2(torusRadius, tubeRadius));
+}
 
-    UCreateCylinderTop(cylinderVertices, cylinderHeight, cylinderSegments, cylinderSegmentAngleStep, cylinderRadius, textureXStep);
+// build the sides, top and bottom of a cylinder and its triangle list
+void UGenerateCylinder(std::vector<PackedVertex>& cylinderVertices, std::vector<GLuint>& cylinderIndices, const GLfloat cylinderRadius, const GLfloat cylinderHeight, const GLuint cylinderSegments) {
+    // the sides and both covers share the angles around the cylinder
+    vector<GLfloat> sines, cosines;
+    USinCosTable(cylinderSegments, sines, cosines);
 
-    mesh.nCylinderTopOrBottonVertices = (cylinderVertices.size() / (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal)) - mesh.nCylinderSideVertices; // number of Vertices to render
+    const GLuint sideVertices = 2 * (cylinderSegments + 1);     // number of vertices in the sides
+    const GLuint topOrBottomVertices = cylinderSegments + 2;    // number of vertices in the top or bottom cover, center and rim
 
-    UCreateCylinderBottom(cylinderVertices, cylinderHeight, cylinderSegments, cylinderSegmentAngleStep, cylinderRadius, textureXStep);
+    cylinderVertices.resize(sideVertices + 2 * topOrBottomVertices);
+    PackedVertex* vertexOutput = cylinderVertices.data();
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)* cylinderVertices.size(), cylinderVertices.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-    cylinderVertices.clear();
+    UCreateCylinderSides(vertexOutput, cylinderSegments, sines.data(), cosines.data(), cylinderRadius, cylinderHeight);
+    UCreateCylinderTop(vertexOutput + sideVertices, cylinderSegments, sines.data(), cosines.data(), cylinderRadius, cylinderHeight);
+    UCreateCylinderBottom(vertexOutput + sideVertices + topOrBottomVertices, cylinderSegments, sines.data(), cosines.data(), cylinderRadius, cylinderHeight);
 
-    ULoadTexture("Data\\white-texture-background.jpg", mesh.CandleTextureId, mesh.CandleTextureWidth, mesh.CandleTextureHeight, mesh.CandleTextureChannels);
+    cylinderIndices.reserve(cylinderIndices.size() + 12 * cylinderSegments);  // a side strip and two fans of cylinderSegments triangles
+    UCreateCylinderIndices(cylinderIndices, sideVertices, topOrBottomVertices);
 }
 
-void ULoadTexture(std::string path, GLuint& textureId, int& textureWidth, int& textureHeight, int& textureChannels) {
-    unsigned char* image = stbi_load(path.c_str(), &textureWidth, &textureHeight, &textureChannels, 0);
-    if (image != nullptr)
-    {
-        // gen texture buffer
-        glGenTextures(1, &textureId);
-        glBindTexture(GL_TEXTURE_2D, textureId); //activate buffer
+// stage every detail level of a cylinder in the shared buffer and return its mesh id
+GLuint UCreateCylinderLevels(GLMesh& mesh, const GLfloat cylinderRadius, const GLfloat cylinderHeight, const char* shapeName) {
+    if (mesh.MeshesCached)
+        return mesh.meshBuffer->findMesh(shapeName);
 
-        // wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    GLuint cylinderMesh = 0;
 
-        // pixel filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    for (GLuint level = 0; level < LOD_LEVELS; level++) {
+        vector<PackedVertex> cylinderVertices;  // temporary buffer to hold the packed vertices
+        vector<GLuint> cylinderIndices;
 
-        if (textureChannels == 3) {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-        }
-        else if (textureChannels == 4) {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureWidth, textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-        }
+        UGenerateCylinder(cylinderVertices, cylinderIndices, cylinderRadius, cylinderHeight, LOD_FINEST_SEGMENTS >> level);
+        UOptimizeVertexCache(cylinderIndices, cylinderVertices.size());
 
-        // Release the image
-        stbi_image_free(image);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        // Stages the vertices for the shared buffer
+        if (level == 0)
+            cylinderMesh = mesh.meshBuffer->addMesh(cylinderVertices, cylinderIndices, shapeName);
+        else
+            mesh.meshBuffer->addLevel(cylinderMesh, cylinderVertices, cylinderIndices);
     }
-}
 
-void UCreateCylinderBottom(std::vector<GLfloat>& cylinderVertices, const GLfloat& cylinderHeight, const GLuint& cylinderSegments, const float& cylinderSegmentAngleStep, const GLfloat& cylinderRadius, const GLfloat& textureXStep)
-{
-    // add bottom cover
+    return cylinderMesh;
+}
 
-    // center bottom vertex
-    cylinderVertices.push_back(0.0f);                   // x
-    cylinderVertices.push_back(0.0f);                   // y
-    cylinderVertices.push_back(cylinderHeight / 2.0f); // z  // I tried a positive Z for top but it ended up on bottom, so I swapped the signs
+// create cylinder
+void UCreateCylinder(GLMesh& mesh, const GLfloat cylinderRadius, const GLfloat cylinderHeight) {
+    GLuint cylinderMesh = MeshBuffer::InvalidMesh;
+    if (!mesh.Tessellated)
+        cylinderMesh = UCreateCylinderLevels(mesh, cylinderRadius, cylinderHeight, "votive cylinder");
 
-    cylinderVertices.push_back(gColorMap[0].r); // red
-    cylinderVertices.push_back(gColorMap[0].g); // green
-    cylinderVertices.push_back(gColorMap[0].b); // blue
+    TextureSlot texture = mesh.textureCache->acquire("Data\\white-texture-background.jpg", TextureFiltering::Trilinear);
 
-    cylinderVertices.push_back(0.5f); // texture x
-    cylinderVertices.push_back(0.5f); // texture y
+    mesh.meshRegistry->addParametric("votive cylinder", cylinderMesh, texture, ParametricSurface::Cylinder, glm::vec2(cylinderRadius, cylinderHeight));
+}
 
-    cylinderVertices.push_back(0.0f);   //normal x
-    cylinderVertices.push_back(1.0f);   //normal y
-    cylinderVertices.push_back(0.0f);   //normal z
+void UCreateCylinderBottom(PackedVertex* bottomVertices, const GLuint cylinderSegments, const GLfloat* sines, const GLfloat* cosines, const GLfloat cylinderRadius, const GLfloat cylinderHeight)
+{
+    // add bottom cover
 
-    for (size_t i = 0; i <= cylinderSegments; i++) { // iterate segments around cylinder
+    // center bottom vertex, z is positive: I tried a positive Z for top but it ended up on bottom, so I swapped the signs
+    bottomVertices[0] = UPackVertex(glm::vec3(0.0f, 0.0f, cylinderHeight / 2.0f), gColorMap[0], glm::vec2(0.5f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-        float currentSegmentAngle = i * cylinderSegmentAngleStep;
+    for (GLuint i = 0; i <= cylinderSegments; i++) { // iterate segments around cylinder
 
-        float x = cos(currentSegmentAngle) * cylinderRadius;
-        float y = sin(currentSegmentAngle) * cylinderRadius;
+        float x = cosines[i] * cylinderRadius;
+        float y = sines[i] * cylinderRadius;
         float z = cylinderHeight / 2.0f; // I tried a positive Z for top but it ended up on bottom, so I swapped the signs
 
-        cylinderVertices.push_back(x);
-        cylinderVertices.push_back(y);
-        cylinderVertices.push_back(z);
-
         glm::vec3 color = gColorMap[i % COLOR_MAP_SIZE];
 
-        cylinderVertices.push_back(color.r); // red
-        cylinderVertices.push_back(color.g); // green
-        cylinderVertices.push_back(color.b); // blue
-
-        cylinderVertices.push_back(textureXStep * i); // texture x
-        cylinderVertices.push_back(0.0f); // texture y
-
-        cylinderVertices.push_back(0.0f);   //normal x
-        cylinderVertices.push_back(1.0f);   //normal y
-        cylinderVertices.push_back(0.0f);   //normal z
+        bottomVertices[i + 1] = UPackVertex(glm::vec3(x, y, z), color, glm::vec2((float)i / cylinderSegments, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     }
 }
 
-void UCreateCylinderTop(std::vector<GLfloat>& cylinderVertices, const GLfloat& cylinderHeight, const GLuint& cylinderSegments, const float& cylinderSegmentAngleStep, const GLfloat& cylinderRadius, const GLfloat& textureXStep)
+void UCreateCylinderTop(PackedVertex* topVertices, const GLuint cylinderSegments, const GLfloat* sines, const GLfloat* cosines, const GLfloat cylinderRadius, const GLfloat cylinderHeight)
 {
     // add top cover
 
-    // center top vertex
-    cylinderVertices.push_back(0.0f);  // x
-    cylinderVertices.push_back(0.0f);  // y
-    cylinderVertices.push_back(-cylinderHeight / 2.0f); // z  // I tried a positive Z for top but it ended up on bottom, so I swapped the signs
-
-    cylinderVertices.push_back(gColorMap[0].r); // red
-    cylinderVertices.push_back(gColorMap[0].g); // green
-    cylinderVertices.push_back(gColorMap[0].b); // blue
-
-    cylinderVertices.push_back(0.5f); // texture x
-    cylinderVertices.push_back(0.5f); // texture y
-
-    cylinderVertices.push_back(0.0f);   //normal x
-    cylinderVertices.push_back(-1.0f);   //normal y
-    cylinderVertices.push_back(0.0f);   //normal z
+    // center top vertex, z is negative: I tried a positive Z for top but it ended up on bottom, so I swapped the signs
+    topVertices[0] = UPackVertex(glm::vec3(0.0f, 0.0f, -cylinderHeight / 2.0f), gColorMap[0], glm::vec2(0.5f, 0.5f), glm::vec3(0.0f, -1.0f, 0.0f));
 
-    for (size_t i = 0; i <= cylinderSegments; i++) { // iterate segments around cylinder
+    for (GLuint i = 0; i <= cylinderSegments; i++) { // iterate segments around cylinder
 
-        float currentSegmentAngle = i * cylinderSegmentAngleStep;
-
-        float x = cos(currentSegmentAngle) * cylinderRadius;
-        float y = sin(currentSegmentAngle) * cylinderRadius;
+        float x = cosines[i] * cylinderRadius;
+        float y = sines[i] * cylinderRadius;
         float z = -cylinderHeight / 2.0f;  // I tried a positive Z for top but it ended up on bottom, so I swapped the signs
 
-        cylinderVertices.push_back(x);
-        cylinderVertices.push_back(y);
-        cylinderVertices.push_back(z);
-
         glm::vec3 color = gColorMap[i % COLOR_MAP_SIZE];
 
-        cylinderVertices.push_back(color.r); // red
-        cylinderVertices.push_back(color.g); // green
-        cylinderVertices.push_back(color.b); // blue
-
-        cylinderVertices.push_back((GLfloat)(textureXStep * i)); // texture x
-        cylinderVertices.push_back(1.0f); // texture y
-
-        cylinderVertices.push_back(0.0f);   //normal x
-        cylinderVertices.push_back(-1.0f);   //normal y
-        cylinderVertices.push_back(0.0f);   //normal z
+        topVertices[i + 1] = UPackVertex(glm::vec3(x, y, z), color, glm::vec2((float)i / cylinderSegments, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
     }
 }
 
-void UCreateCylinderSides(const GLuint& cylinderSegments, const float& cylinderSegmentAngleStep, const GLfloat& cylinderRadius, const GLfloat& cylinderHeight, std::vector<GLfloat>& cylinderVertices, const GLfloat& textureXStep)
+void UCreateCylinderSides(PackedVertex* sideVertices, const GLuint cylinderSegments, const GLfloat* sines, const GLfloat* cosines, const GLfloat cylinderRadius, const GLfloat cylinderHeight)
 {
-    // add cylinder sides
-    for (size_t i = 0; i <= cylinderSegments; i++) { // iterate segments around cylinder
+    // add cylinder sides, a top and a bottom vertex per segment
+    for (GLuint i = 0; i <= cylinderSegments; i++) { // iterate segments around cylinder
 
         glm::vec3 color = gColorMap[i % COLOR_MAP_SIZE];
 
-        float currentSegmentAngle = i * cylinderSegmentAngleStep;
-
-        float x = cos(currentSegmentAngle) * cylinderRadius;
-        float y = sin(currentSegmentAngle) * cylinderRadius;
+        float x = cosines[i] * cylinderRadius;
+        float y = sines[i] * cylinderRadius;
         float z_top = -cylinderHeight / 2.0f;
         float z_bottom = cylinderHeight / 2.0f;
+        float textureX = (float)i / cylinderSegments;
 
-        cylinderVertices.push_back(x);
-        cylinderVertices.push_back(y);
-        cylinderVertices.push_back(z_top);
-
-        cylinderVertices.push_back(color.r); // red
-        cylinderVertices.push_back(color.g); // green
-        cylinderVertices.push_back(color.b); // blue
-
-        cylinderVertices.push_back((GLfloat)(textureXStep * i));   // texture x
-        cylinderVertices.push_back(1.0f);                  // texture y
-
-        cylinderVertices.push_back(cos(currentSegmentAngle)); //normal x
-        cylinderVertices.push_back(0.0f);   //normal y
-        cylinderVertices.push_back(sin(currentSegmentAngle)); //normal z
+        glm::vec3 normal(cosines[i], 0.0f, sines[i]);
 
-        cylinderVertices.push_back(x);
-        cylinderVertices.push_back(y);
-        cylinderVertices.push_back(z_bottom);
-
-        cylinderVertices.push_back(color.r); // red
-        cylinderVertices.push_back(color.g); // green
-        cylinderVertices.push_back(color.b); // blue
-
-        cylinderVertices.push_back((GLfloat)(textureXStep * i)); // texture x
-        cylinderVertices.push_back(0.0f); // texture y
-
-        cylinderVertices.push_back(cos(currentSegmentAngle)); //normal x
-        cylinderVertices.push_back(0.0f);   //normal y
-        cylinderVertices.push_back(sin(currentSegmentAngle)); //normal z
+        sideVertices[2 * i] = UPackVertex(glm::vec3(x, y, z_top), color, glm::vec2(textureX, 1.0f), normal);
+        sideVertices[2 * i + 1] = UPackVertex(glm::vec3(x, y, z_bottom), color, glm::vec2(textureX, 0.0f), normal);
     }
 }
 
 // create cylinder
-void UCreateCandleCylinder(GLMesh& mesh, const GLfloat cylinderRadius, const GLfloat cylinderHeight, const GLuint cylinderSegments) {
-    vector<GLfloat> cylinderVertices;  // temporary buffer to hold both position and color data
-
-    const auto cylinderSegmentAngleStep = (2 * glm::pi<float>()) / (float)cylinderSegments;  // calculate angle in radians to increment by
-
-    GLfloat textureXStep = 1.0f / cylinderSegments;
-
-    UCreateCylinderSides(cylinderSegments, cylinderSegmentAngleStep, cylinderRadius, cylinderHeight, cylinderVertices, textureXStep);
-
-    mesh.CandleCylinderStride = sizeof(GLfloat) * (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal);
-    mesh.CandleCylinderSideVertices = cylinderVertices.size() / (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal); // number of torusVertices to render
-
-    UCreateCylinderTop(cylinderVertices, cylinderHeight, cylinderSegments, cylinderSegmentAngleStep, cylinderRadius, textureXStep);
+void UCreateCandleCylinder(GLMesh& mesh, const GLfloat cylinderRadius, const GLfloat cylinderHeight) {
+    GLuint cylinderMesh = MeshBuffer::InvalidMesh;
+    if (!mesh.Tessellated)
+        cylinderMesh = UCreateCylinderLevels(mesh, cylinderRadius, cylinderHeight, "candle cylinder");
 
-    mesh.CandleCylinderTopOrBottomVertices = (cylinderVertices.size() / (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal)) - mesh.CandleCylinderSideVertices; // number of Vertices to render
+    TextureSlot texture = mesh.textureCache->acquire("Data\\copper.jpg", TextureFiltering::Trilinear);
 
-    UCreateCylinderBottom(cylinderVertices, cylinderHeight, cylinderSegments, cylinderSegmentAngleStep, cylinderRadius, textureXStep);
-
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * cylinderVertices.size(), cylinderVertices.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-    cylinderVertices.clear();
-
-    ULoadTexture("Data\\copper.jpg", mesh.CandleCylinderTextureId, mesh.CandleCylinderTextureWidth, mesh.CandleCylinderTextureHeight, mesh.CandleCylinderTextureChannels);
+    mesh.meshRegistry->addParametric("candle cylinder", cylinderMesh, texture, ParametricSurface::Cylinder, glm::vec2(cylinderRadius, cylinderHeight));
 }
 
 // create cylinder
-void UCreateSprayCylinder(GLMesh& mesh, const GLfloat cylinderRadius, const GLfloat cylinderHeight, const GLuint cylinderSegments) {
-    vector<GLfloat> cylinderVertices;  // temporary buffer to hold both position and color data
-
-    const auto cylinderSegmentAngleStep = (2 * glm::pi<float>()) / (float)cylinderSegments;  // calculate angle in radians to increment by
-
-    GLfloat textureXStep = 1.0f / cylinderSegments;
-
-    UCreateCylinderSides(cylinderSegments, cylinderSegmentAngleStep, cylinderRadius, cylinderHeight, cylinderVertices, textureXStep);
-
-    mesh.SprayCylinderStride = sizeof(GLfloat) * (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal);
-    mesh.SprayBaseCylinderSideVertices = cylinderVertices.size() / (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal); // number of torusVertices to render
-
-    UCreateCylinderTop(cylinderVertices, cylinderHeight, cylinderSegments, cylinderSegmentAngleStep, cylinderRadius, textureXStep);
-
-    mesh.SprayBaseCylinderTopOrBottomVertices = (cylinderVertices.size() / (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal)) - mesh.CandleCylinderSideVertices; // number of Vertices to render
+void UCreateSprayCylinder(GLMesh& mesh, const GLfloat cylinderRadius, const GLfloat cylinderHeight) {
+    GLuint cylinderMesh = MeshBuffer::InvalidMesh;
+    if (!mesh.Tessellated)
+        cylinderMesh = UCreateCylinderLevels(mesh, cylinderRadius, cylinderHeight, "spray cylinder");
 
-    UCreateCylinderBottom(cylinderVertices, cylinderHeight, cylinderSegments, cylinderSegmentAngleStep, cylinderRadius, textureXStep);
+    TextureSlot texture = mesh.textureCache->acquire("Data\\chrome.jpg", TextureFiltering::Trilinear);
 
-    ULoadTexture("Data\\chrome.jpg", mesh.SprayCylinderTextureId, mesh.SprayBaseCylinderTextureWidth, mesh.SprayBaseCylinderTextureHeight, mesh.SprayBaseCylinderTextureChannels);
+    mesh.meshRegistry->addParametric("spray cylinder", cylinderMesh, texture, ParametricSurface::Cylinder, glm::vec2(cylinderRadius, cylinderHeight));
 }
 
-
 void UCreateCandleBox(GLMesh& mesh) {
     GLfloat vertices[] = {
         // y is up
@@ -1539,12 +1076,11 @@ void UCreateCandleBox(GLMesh& mesh) {
         // right left front corner omitted
     };
 
-    mesh.CandleBoxStride = sizeof(GLfloat) * (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal);
-    mesh.CandleBoxVertices = sizeof(vertices) / mesh.PlaneStride;
+    const GLuint vertexCount = sizeof(vertices) / (11 * sizeof(GLfloat));
 
-    ULoadTexture("Data\\wood.jpg", mesh.CandleBoxTextureId, mesh.CandleBoxTextureWidth, mesh.CandleBoxTextureHeight, mesh.CandleBoxTextureChannels);
+    TextureSlot texture = mesh.textureCache->acquire("Data\\wood.jpg");
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    mesh.meshRegistry->add("candle box", UAddListMesh(mesh, vertices, vertexCount, "candle box"), texture);
 }
 
 void UCreateMatchBox(GLMesh& mesh) {
@@ -1594,13 +1130,11 @@ void UCreateMatchBox(GLMesh& mesh) {
         //bottom omitted
     };
 
-    mesh.MatchBoxStride = sizeof(GLfloat) * (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal);
-    mesh.MatchBoxVertices = sizeof(vertices) / mesh.MatchBoxStride;
+    const GLuint vertexCount = sizeof(vertices) / (11 * sizeof(GLfloat));
 
-    stbi_set_flip_vertically_on_load(true);
-    ULoadTexture("Data\\matchbox.jpg", mesh.MatchBoxTextureId, mesh.MatchBoxTextureWidth, mesh.MatchBoxTextureHeight, mesh.MatchBoxTextureChannels);
+    TextureSlot texture = mesh.textureCache->acquire("Data\\matchbox.jpg");
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    mesh.meshRegistry->add("matchbox", UAddListMesh(mesh, vertices, vertexCount, "matchbox"), texture);
 }
 
 void UCreatePlane(GLMesh& mesh)
@@ -1615,57 +1149,413 @@ void UCreatePlane(GLMesh& mesh)
        -1.0f, 0.0f, -1.0f,              1.0f, 0.0f, 0.0f,   0.0f, 1.0f,              0.0f, 1.0f, 0.0f,           // vert 6 red
     };
 
-    mesh.PlaneStride = sizeof(GLfloat) * (mesh.ValuesPerVertex + mesh.ValuesPerColor + mesh.ValuesPerTexture + mesh.ValuesPerNormal);
-    mesh.nPlaneVertices = sizeof(vertices) / mesh.PlaneStride;
+    const GLuint vertexCount = sizeof(vertices) / (11 * sizeof(GLfloat));
+    GLuint planeMesh = UAddListMesh(mesh, vertices, vertexCount, "plane");
+
+    TextureSlot texture = mesh.textureCache->acquire("Data\\newspaper.jpg");
+
+    mesh.meshRegistry->add("plane", planeMesh, texture);
+}
+
+// resolve the lighting program's uniform handles once so drawing never looks up names
+void UResolveLightingUniforms(GLMesh& mesh)
+{
+    Shader& program = *mesh.lightingProgram;
+    LightingUniforms& uniforms = mesh.lightingUniforms;
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    uniforms.Texture            = program.uniform<GLint>("uTexture");
 
-    // load texture 
-    stbi_set_flip_vertically_on_load(true);
-    ULoadTexture("Data\\newspaper.jpg", mesh.NewsPaperTextureId, mesh.NewsPaperTextureWidth, mesh.NewsPaperTextureHeight, mesh.NewsPaperTextureChannels);
+    if (mesh.tessellatedProgram != nullptr)
+        mesh.tessellatedUniforms.Texture = mesh.tessellatedProgram->uniform<GLint>("uTexture");
+}
+
+// create the uniform buffer behind FrameBlock and attach it to its binding point
+void UCreateFrameUniformBuffer(GLMesh& mesh)
+{
+    glGenBuffers(1, &mesh.frameUbo);
+    GLStateCache::get().bindBuffer(GL_UNIFORM_BUFFER, mesh.frameUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    GLStateCache::get().bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    GLStateCache::get().bindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, mesh.frameUbo);
+}
+
+// the scene's candle flames, each lighting only what is within its radius
+void UCreatePointLights(GLMesh& mesh)
+{
+    mesh.clusteredLights = new ClusteredLights();
+    mesh.clusteredLights->setDepthRange(NEAR_PLANE, FAR_PLANE);
+
+    mesh.pointLights = mesh.scene->getPointLights();
+}
+
+// render with 2 to 1024 point lights scattered over the table and report the average frame time of each count
+void URunLightBenchmark(GLMesh& mesh)
+{
+    UUpdateTextures(mesh, true);    // measured with every texture resident, not the placeholders
+
+    const int framesPerCount = 100;
+    std::vector<PointLight> sceneLights = mesh.pointLights;
+    std::mt19937 random(330);   // fixed seed, every run places the same lights
+    std::uniform_real_distribution<GLfloat> across(-15.0f, 15.0f);
+    std::uniform_real_distribution<GLfloat> deep(-10.0f, 10.0f);
+    std::uniform_real_distribution<GLfloat> height(-1.0f, 4.0f);
+    std::uniform_real_distribution<GLfloat> tint(0.2f, 0.6f);
+
+    glfwSwapInterval(0);    // do not wait for vertical sync between frames
+
+    for (GLuint lightCount = 2; lightCount <= 1024; lightCount *= 2) {
+        mesh.pointLights.clear();
+        for (GLuint i = 0; i < lightCount; i++)
+            mesh.pointLights.push_back({ glm::vec4(across(random), height(random), deep(random), 4.0f),
+                                         glm::vec4(1.0f, tint(random) + 0.2f, tint(random) - 0.2f, 0.5f) });
+
+        // one frame outside the timing so buffer growth is not measured
+        URender(mesh);
+        glFinish();
+
+        double startTime = glfwGetTime();
+        for (int frame = 0; frame < framesPerCount; frame++)
+            URender(mesh);
+        glFinish();
+
+        double frameTime = (glfwGetTime() - startTime) * 1000.0 / framesPerCount;
+
+        cout << "INFO: " << lightCount << " point lights, " << frameTime << " ms per frame, "
+             << mesh.clusteredLights->getLightIndexCount() << " cluster light entries" << endl;
+    }
+
+    mesh.pointLights = sceneLights;
+}
+
+// fill the table with 16 to 1024 extra candle holders and votives and report the average frame time of each count
+void URunInstanceBenchmark(GLMesh& mesh)
+{
+    UUpdateTextures(mesh, true);    // measured with every texture resident, not the placeholders
+
+    const int framesPerCount = 100;
+    const MeshHandle torus = mesh.meshRegistry->find("torus");
+    const MeshHandle votive = mesh.meshRegistry->find("votive cylinder");
+
+    glfwSwapInterval(0);    // do not wait for vertical sync between frames
+
+    for (GLuint holderCount = 16; holderCount <= 1024; holderCount *= 2) {
+        UClearScene(mesh);
+        UAddSceneObjects(mesh);
+
+        // square grid over the newspaper, holders shrink so neighbours do not overlap
+        GLuint columns = (GLuint)ceil(sqrt((GLfloat)holderCount));
+        GLuint rows = (holderCount + columns - 1) / columns;
+        glm::vec2 spacing(28.0f / columns, 18.0f / rows);
+        GLfloat size = glm::min(glm::min(spacing.x, spacing.y) / 6.0f, 1.0f);   // a holder is 6 units across
+
+        for (GLuint i = 0; i < holderCount; i++) {
+            glm::vec3 position(-14.0f + spacing.x * (i % columns + 0.5f), 3.0f * size, -9.0f + spacing.y * (i / columns + 0.5f));
+            glm::mat4 model = glm::translate(position) * glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) * glm::scale(glm::vec3(size));
+
+            UAddObject(mesh, torus, UObjectData(model, 0.1f, 0.8f, 32.0f, glm::vec3(10.0f, 5.0f, -10.0f), glm::vec3(1.0f, 0.839215686f, 0.666666667f), 0.0f));
+            UAddObject(mesh, votive, UObjectData(model, 0.1f, 0.8f, 32.0f, glm::vec3(10.0f, 5.0f, -10.0f), glm::vec3(1.0f), 1.0f));
+        }
+
+        UUploadScene(mesh);
+
+        // one frame outside the timing so buffer growth is not measured
+        URender(mesh);
+        glFinish();
+
+        double startTime = glfwGetTime();
+        for (int frame = 0; frame < framesPerCount; frame++)
+            URender(mesh);
+        glFinish();
+
+        double frameTime = (glfwGetTime() - startTime) * 1000.0 / framesPerCount;
+
+        cout << "INFO: " << holderCount << " extra candle holders, " << frameTime << " ms per frame, "
+             << mesh.sceneBatch->getTriangleCount() << " triangles, " << mesh.sceneBatch->getCommandCount() << " indirect commands, "
+             << mesh.sceneBatch->getDrawCallCount() << " multi draw calls" << endl;
+    }
+
+    UClearScene(mesh);
+    UAddSceneObjects(mesh);
+    UUploadScene(mesh);
+}
+
+// time the vertex stage of three candle holder tori of 256 to 1024 segments, with the matrices derived per vertex
+// in the shader against the CPU computed model-view-projection and normal matrices
+void URunVertexBenchmark(GLMesh& mesh)
+{
+    UUpdateTextures(mesh, true);    // measured with every texture resident, not the placeholders
+
+    const int framesPerSize = 50;
+
+    // the old shader, identical apart from building the matrices for every vertex
+    string perVertexSource = Shader::LightingVertexShaderSource;
+    perVertexSource.insert(perVertexSource.find('\n'), "\n#define PER_VERTEX_MATRICES");
+    Shader perVertexProgram(perVertexSource.c_str(), Shader::LightingFragmentShaderSource);
+    Shader* programs[] = { &perVertexProgram, mesh.lightingProgram };
+    const char* programNames[] = { "per vertex inverse", "CPU matrices" };
+
+    glm::mat4 view = glm::lookAt(gCamera.Position, gCamera.Position + gCamera.Front, gCamera.Up);
+    const TextureSlot torusTexture = mesh.meshRegistry->getTexture(mesh.meshRegistry->find("torus"));
+
+    // nothing is rasterized so only the vertex stage is measured
+    glfwSwapInterval(0);
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    for (GLuint segments = 256; segments <= 1024; segments *= 2) {
+        vector<PackedVertex> torusVertices;
+        vector<GLuint> torusIndices;
+        UGenerateTorus(torusVertices, torusIndices, 2.0f, 1.0f, segments, segments);
+
+        MeshBuffer torusBuffer;
+        GLuint torus = torusBuffer.addMesh(torusVertices, torusIndices, "torus");
+        torusBuffer.upload();
+
+        SceneBatch torusBatch(torusBuffer);
+        const GLfloat holderPositions[] = { 1.0f, 11.0f, -9.0f };
+        for (GLfloat x : holderPositions) {
+            glm::mat4 model = glm::translate(glm::vec3(x, 3.0f, 0.3f)) * glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            ObjectData object = UObjectData(model, 0.1f, 0.8f, 32.0f, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f);
+            object.Material.w = (GLfloat)TextureArray::getLayer(torusTexture);
+            torusBatch.add(torus, mesh.textureArray->getTexture(torusTexture), object);
+        }
+        torusBatch.upload();
+
+        for (int p = 0; p < 2; p++) {
+            programs[p]->use();
+
+            // one frame outside the timing so buffer creation is not measured
+            torusBatch.update(view, gWindow.Projection, gWindow.Height);
+            torusBatch.draw();
+            glFinish();
+
+            double startTime = glfwGetTime();
+            for (int frame = 0; frame < framesPerSize; frame++) {
+                torusBatch.update(view, gWindow.Projection, gWindow.Height);
+                torusBatch.draw();
+            }
+            glFinish();
+
+            double frameTime = (glfwGetTime() - startTime) * 1000.0 / framesPerSize;
+
+            cout << "INFO: 3 tori of " << segments << " x " << segments << " segments, " << torusVertices.size() * 3 << " vertices, "
+                 << frameTime << " ms per frame with " << programNames[p] << endl;
+        }
+    }
+
+    glDisable(GL_RASTERIZER_DISCARD);
+}
+
+// time the torus generator at 256 to 2048 segments on one thread and on every thread of the pool, and the
+// vectorized sine and cosine against the standard library
+void URunGenerationBenchmark()
+{
+    const int runsPerSize = 5;
+
+    vector<GLfloat> angles(1 << 20), sines(angles.size()), cosines(angles.size());
+    for (size_t i = 0; i < angles.size(); i++)
+        angles[i] = i * glm::two_pi<float>() / angles.size();
+
+    double startTime = glfwGetTime();
+    USinCos(angles.data(), sines.data(), cosines.data(), angles.size());
+    double vectorTime = glfwGetTime() - startTime;
+
+    startTime = glfwGetTime();
+    for (size_t i = 0; i < angles.size(); i++) {
+        sines[i] = sin(angles[i]);
+        cosines[i] = cos(angles[i]);
+    }
+    double scalarTime = glfwGetTime() - startTime;
+
+    cout << "INFO: sine and cosine of " << angles.size() << " angles, " << vectorTime * 1000.0 << " ms vectorized, "
+         << scalarTime * 1000.0 << " ms with sin and cos" << endl;
+
+    ThreadPool singleThread(1);
+    ThreadPool* pools[] = { &singleThread, &ThreadPool::get() };
+
+    for (GLuint segments = 256; segments <= 2048; segments *= 2) {
+        for (ThreadPool* pool : pools) {
+            vector<PackedVertex> torusVertices;
+            vector<GLuint> torusIndices;
+
+            startTime = glfwGetTime();
+            for (int run = 0; run < runsPerSize; run++)
+                UGenerateTorus(torusVertices, torusIndices, 2.0f, 1.0f, segments, segments, *pool);
+            double runTime = (glfwGetTime() - startTime) / runsPerSize;
+
+            cout << "INFO: torus of " << segments << " x " << segments << " segments, " << torusVertices.size() << " vertices in "
+                 << runTime * 1000.0 << " ms on " << pool->getThreadCount() << " threads, "
+                 << torusVertices.size() / runTime / 1.0e6 << " million vertices per second" << endl;
+        }
+    }
+}
+
+// generate the torus and cylinder at every detail level and report the vertex cache miss ratio of each before and after
+// reordering its triangles, and how long the reordering took
+void URunVertexCacheBenchmark()
+{
+    const GLuint fifoSize = 16;     // typical post-transform cache size the order is measured against
+
+    for (GLuint level = 0; level < LOD_LEVELS; level++) {
+        const GLuint segments = LOD_FINEST_SEGMENTS >> level;
+
+        for (int shape = 0; shape < 2; shape++) {
+            vector<PackedVertex> vertices;
+            vector<GLuint> indices;
+
+            if (shape == 0)
+                UGenerateTorus(vertices, indices, 2.0f, 1.0f, segments, segments);
+            else
+                UGenerateCylinder(vertices, indices, 1.0f, 2.0f, segments);
+
+            GLfloat acmrBefore = UComputeACMR(indices, fifoSize);
+            double startTime = glfwGetTime();
+            UOptimizeVertexCache(indices, vertices.size());
+            double optimizeTime = glfwGetTime() - startTime;
+            GLfloat acmrAfter = UComputeACMR(indices, fifoSize);
+
+            cout << "INFO: " << (shape == 0 ? "torus " : "cylinder ") << indices.size() / 3 << " triangles, " << vertices.size()
+                 << " vertices, ACMR " << acmrBefore << " before and " << acmrAfter << " after vertex cache optimization in "
+                 << optimizeTime * 1000.0 << " ms" << endl;
+        }
+    }
+}
+
+// render the scene into a 1920 x 1080 framebuffer with the textures sampled from the full size image only, trilinear
+// from their mip chains and anisotropic, and report the average frame time of each
+void URunTextureBenchmark(GLMesh& mesh)
+{
+    double startTime = glfwGetTime();
+    UUpdateTextures(mesh, true);    // measured with every texture resident, not the placeholders
+
+    // cooked textures bring the chain texcook built, only the decoded ones follow --cpu-mipmaps
+    const GLuint decodedCount = mesh.textureArray->getLayerCount(LayerFormat::Rgba8);
+    cout << "INFO: Textures resident after waiting " << (glfwGetTime() - startTime) * 1000.0 << " ms, "
+         << mesh.textureArray->getLayerCount() - decodedCount << " with mip chains cooked by texcook and " << decodedCount
+         << " with mip chains built on the " << (mesh.TextureMips == MipGeneration::Cpu ? "CPU" : "GPU") << endl;
+
+    const int framesPerFiltering = 100;
+    const GLuint width = 1920, height = 1080;
+    const TextureFiltering filterings[] = { TextureFiltering::Bilinear, TextureFiltering::Trilinear, TextureFiltering::Anisotropic };
+    const char* filteringNames[] = { "bilinear without mip levels", "trilinear", "anisotropic" };
+
+    // the window keeps its size, the frames go to a framebuffer of the measured size
+    GLuint framebuffer = 0, renderbuffers[2] = {};
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+
+    WindowParams window = gWindow;
+    gWindow.Width = width;
+    gWindow.Height = height;
+    gWindow.Projection = glm::perspective(glm::radians(gCamera.Fov), (GLfloat)width / (GLfloat)height, NEAR_PLANE, FAR_PLANE);
+    glViewport(0, 0, width, height);
+
+    glfwSwapInterval(0);    // do not wait for vertical sync between frames
+
+    for (int f = 0; f < 3; f++) {
+        mesh.textureArray->overrideFiltering(filterings[f]);
+
+        // one frame outside the timing so the sampler change is not measured
+        URender(mesh);
+        glFinish();
+
+        double filteringStartTime = glfwGetTime();
+        for (int frame = 0; frame < framesPerFiltering; frame++)
+            URender(mesh);
+        glFinish();
+
+        double frameTime = (glfwGetTime() - filteringStartTime) * 1000.0 / framesPerFiltering;
+
+        cout << "INFO: " << width << " x " << height << " with " << filteringNames[f] << " textures, " << frameTime << " ms per frame" << endl;
+    }
+
+    mesh.textureArray->restoreFiltering();
+
+    gWindow = window;
+    glViewport(0, 0, gWindow.Width, gWindow.Height);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(2, renderbuffers);
+    glDeleteFramebuffers(1, &framebuffer);
+}
+
+// triangle list for a cylinder built as a side strip followed by the top and bottom fans
+void UCreateCylinderIndices(std::vector<GLuint>& indices, GLuint sideVertices, GLuint topOrBottomVertices)
+{
+    UAppendStripIndices(indices, 0, sideVertices);
+    UAppendFanIndices(indices, sideVertices, topOrBottomVertices);
+    UAppendFanIndices(indices, sideVertices + topOrBottomVertices, topOrBottomVertices);
+}
+
+// stage a shape given as a literal table of 11 floats per vertex, drawn as a plain triangle list
+GLuint UAddListMesh(GLMesh& mesh, const GLfloat* vertices, GLuint vertexCount, const char* shapeName)
+{
+    if (mesh.MeshesCached)
+        return mesh.meshBuffer->findMesh(shapeName);
+
+    vector<PackedVertex> packedVertices;
+    UPackVertices(vertices, vertexCount, packedVertices);
+
+    vector<GLuint> indices;
+    UAppendListIndices(indices, 0, vertexCount);
+    return mesh.meshBuffer->addMesh(packedVertices, indices, shapeName);
 }
 
 // Implements the UCreateMesh function
 // create a torus to represent a candle holder and cylinder inside the torus to represent a votive
 void UCreateMesh(GLMesh& mesh)
 {
-    const GLuint  torusSegments = 30;       // number of segments to draw around torus
-    const GLuint  tubePoints    = 30;       // number of points around tube
     const GLfloat torusRadius   = 2.0f;     // radius (R) of torus
     const GLfloat tubeRadius    = 1.0f;     // radius (r) of tube around torus
 
-    const GLuint  cylinderSegments = 30;    // number of segments to draw around torus
     const GLfloat cylinderRadius   = torusRadius - tubeRadius;
     const GLfloat cylinderHeight   = 0.75f * tubeRadius; // we don't want cylinder as tall as torus height
 
-    glGenVertexArrays(1, &mesh.vao); // we can also generate multiple VAOs or buffers at the same time
-    glBindVertexArray(mesh.vao);     // activate vertex array
+    const GLfloat candleCylinderRadius  = 2.0f;
+    const GLfloat candleCylinderHeight  = 1.0f;
+    const GLfloat sprayCylinderRadius   = 1.0f;
+    const GLfloat sprayCylinderHeight   = 1.0f;
 
-    // send vertex buffer to graphics card memory
-    glGenBuffers(6, mesh.vbos);
+    // every parameter the generators depend on, the mesh cache file is named by a hash of it
+    const GLfloat cacheKey[] = {
+        (GLfloat)MESH_GENERATOR_VERSION, (GLfloat)LOD_LEVELS, (GLfloat)LOD_FINEST_SEGMENTS, mesh.Tessellated ? 1.0f : 0.0f,
+        torusRadius, tubeRadius, cylinderRadius, cylinderHeight,
+        candleCylinderRadius, candleCylinderHeight, sprayCylinderRadius, sprayCylinderHeight
+    };
 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);    // Activates the buffer
-    UCreatePlane(mesh);
+    mesh.meshBuffer = new MeshBuffer();    // every shape shares one vertex and one index buffer
+    mesh.meshRegistry = new MeshRegistry(*mesh.meshBuffer);
+    mesh.textureLoader = new TextureLoader(*mesh.textureArray, mesh.TextureMips);   // the shapes' images decode while the rest of startup runs
+    if (mesh.CookedTextures)
+        mesh.textureLoader->loadCookedIndex("Data\\textures.index");
+    mesh.textureCache = new TextureCache(*mesh.textureLoader);
 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[1]);    // Activates the buffer
-    UCreateTorus(mesh, torusRadius, tubeRadius, torusSegments, tubePoints);
+    double startTime = glfwGetTime();
+    mesh.MeshesCached = mesh.meshBuffer->loadCache(cacheKey, sizeof(cacheKey));
+    double cacheTime = glfwGetTime() - startTime;
 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[2]);    // Activates the cylinder buffer
-    UCreateCylinder(mesh, cylinderRadius, cylinderHeight, cylinderSegments);
+    if (mesh.MeshesCached)
+        cout << "INFO: Mapped " << mesh.meshBuffer->getMeshCount() << " meshes from the mesh cache in " << cacheTime * 1000.0 << " ms" << endl;
 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[3]);    // Activates the cylinder buffer
+    UCreatePlane(mesh);
+    UCreateTorus(mesh, torusRadius, tubeRadius);
+    UCreateCylinder(mesh, cylinderRadius, cylinderHeight);
     UCreateCandleBox(mesh);
-
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[4]);    // Activates the matchbox buffer
     UCreateMatchBox(mesh);
+    UCreateCandleCylinder(mesh, candleCylinderRadius, candleCylinderHeight);
+    UCreateSprayCylinder(mesh, sprayCylinderRadius, sprayCylinderHeight);
 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[5]);    // Activates the cylinder buffer
-    UCreateCandleCylinder(mesh, 2.0f, 1.0f, cylinderSegments);
-
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[6]);    // Activates the cylinder buffer
-    UCreateSprayCylinder(mesh, 1.0f, 1.0f, cylinderSegments);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);               // unbind the buffer
+    // a cached buffer was uploaded straight from the mapping
+    if (!mesh.MeshesCached) {
+        mesh.meshBuffer->saveCache(cacheKey, sizeof(cacheKey));
+        mesh.meshBuffer->upload();        // send the staged vertices and indices to graphics card memory
+    }
 }
 
 
@@ -1681,20 +1571,74 @@ int main(int argc, char* argv[])
     if (!UInitialize(gWindow, &gWindow.windowPtr))
         return EXIT_FAILURE;
 
+    // Create the shader programs, only the lighting program is drawn with so the others are never built
+    ShaderLibrary* shaderLibrary = new ShaderLibrary();
+
+    // --tessellation draws the torus and cylinders from patches the GPU refines instead of baked meshes
+    // --scene <file> draws another scene file, text or binary
+    // --save-binary-scene <file> writes the scene in its binary form
+    // --cpu-mipmaps downsamples the textures on the decoder threads instead of with glGenerateMipmap
+    // --no-cooked-textures ignores the compressed textures texcook writes and decodes the source images
+    string scenePath = "Data\\candles.scene";
+    string binaryScenePath;
+
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--tessellation")
+            mesh.Tessellated = true;
+        else if (string(argv[i]) == "--scene" && i + 1 < argc)
+            scenePath = argv[++i];
+        else if (string(argv[i]) == "--save-binary-scene" && i + 1 < argc)
+            binaryScenePath = argv[++i];
+        else if (string(argv[i]) == "--cpu-mipmaps")
+            mesh.TextureMips = MipGeneration::Cpu;
+        else if (string(argv[i]) == "--no-cooked-textures")
+            mesh.CookedTextures = false;
+    }
+
+    double sceneStartTime = glfwGetTime();
+
+    mesh.scene = new Scene();
+    if (!mesh.scene->load(scenePath))
+        return EXIT_FAILURE;
+
+    cout << "INFO: Scene " << scenePath << " of " << mesh.scene->getObjects().size() << " objects and " << mesh.scene->getPointLights().size()
+         << " point lights loaded in " << (glfwGetTime() - sceneStartTime) * 1000.0 << " ms" << endl;
+
+    if (!binaryScenePath.empty() && !mesh.scene->saveBinary(binaryScenePath))
+        cout << "ERROR::SCENE::SAVE_FAILED " << binaryScenePath << endl;
+
+    // start compiling now, the driver works on it while the meshes and textures load
+    shaderLibrary->prefetch(ProgramId::Lighting);
+    if (mesh.Tessellated)
+        shaderLibrary->prefetch(ProgramId::TessellatedLighting);
+
+    // the layers the shapes' textures are loaded into, filled as their images arrive
+    mesh.textureArray = new TextureArray(*shaderLibrary);
+
     // Create the mesh
     UCreateMesh(mesh); // Calls the function to create the Vertex Buffer Object
 
-    // Create the shader program
-    Shader* defaultShader = new Shader();
-    Shader* textureShader = new Shader(Shader::TextureVertexShaderSource, Shader::TextureFragmentShaderSource);
-    Shader* planeShader = new Shader(Shader::LightingVertexShaderSource, Shader::LightingFragmentShaderSource);
+    // first use of the program, only waits if the compile is still running
+    double shaderStartTime = glfwGetTime();
 
-    if (defaultShader->getProgramId() == 0  || textureShader->getProgramId() == 0 || planeShader->getProgramId() == 0)
+    mesh.lightingProgram = shaderLibrary->get(ProgramId::Lighting);
+    if (mesh.lightingProgram->getProgramId() == 0)
         return EXIT_FAILURE;
 
-    mesh.defaultProgram = defaultShader;
-    mesh.textureProgram = textureShader;
-    mesh.lightingProgram = planeShader;
+    cout << "INFO: Lighting program ready after waiting " << (glfwGetTime() - shaderStartTime) * 1000.0 << " ms, "
+         << (mesh.lightingProgram->isFromBinaryCache() ? "loaded from" : "not in") << " the binary cache" << endl;
+
+    if (mesh.Tessellated) {
+        mesh.tessellatedProgram = shaderLibrary->get(ProgramId::TessellatedLighting);
+        if (mesh.tessellatedProgram->getProgramId() == 0)
+            return EXIT_FAILURE;
+    }
+
+    UResolveLightingUniforms(mesh);
+    UCreateFrameUniformBuffer(mesh);
+    UCreatePointLights(mesh);
+
+    UCreateScene(mesh);
 
     // Sets the background color of the window to black (it will be implicitely used by glClear)
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -1703,19 +1647,65 @@ int main(int argc, char* argv[])
     glEnable(GL_DEPTH_TEST);
 
     // initialize window perspective projection 
-    gWindow.Projection = glm::perspective(glm::radians(gCamera.Fov), (GLfloat)gWindow.Width / (GLfloat)gWindow.Height, 0.1f, 100.0f);
+    gWindow.Projection = glm::perspective(glm::radians(gCamera.Fov), (GLfloat)gWindow.Width / (GLfloat)gWindow.Height, NEAR_PLANE, FAR_PLANE);
     gWindow.ProjectionMode = WindowProjection::Perspective;
 
+    // --light-benchmark measures frame time against the point light count instead of running the scene
+    // --instance-benchmark measures it against the number of instanced candle holders
+    // --vertex-benchmark measures the vertex stage of finely tessellated tori
+    // --generation-benchmark measures how fast the CPU builds torus vertices
+    // --vertex-cache-benchmark reports how well the torus and cylinder indices reuse the vertex cache
+    // --texture-benchmark measures frame time at 1080p with every filtering of the textures
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--light-benchmark") {
+            URunLightBenchmark(mesh);
+            glfwSetWindowShouldClose(gWindow.windowPtr, true);
+        }
+        else if (string(argv[i]) == "--instance-benchmark") {
+            URunInstanceBenchmark(mesh);
+            glfwSetWindowShouldClose(gWindow.windowPtr, true);
+        }
+        else if (string(argv[i]) == "--vertex-benchmark") {
+            URunVertexBenchmark(mesh);
+            glfwSetWindowShouldClose(gWindow.windowPtr, true);
+        }
+        else if (string(argv[i]) == "--generation-benchmark") {
+            URunGenerationBenchmark();
+            glfwSetWindowShouldClose(gWindow.windowPtr, true);
+        }
+        else if (string(argv[i]) == "--vertex-cache-benchmark") {
+            URunVertexCacheBenchmark();
+            glfwSetWindowShouldClose(gWindow.windowPtr, true);
+        }
+        else if (string(argv[i]) == "--texture-benchmark") {
+            URunTextureBenchmark(mesh);
+            glfwSetWindowShouldClose(gWindow.windowPtr, true);
+        }
+    }
+
+    bool firstFrame = true;
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(gWindow.windowPtr))
     {
+        // the previous frame's bind counts become the ones reported
+        GLStateCache::get().beginFrame();
+
         // input
         UProcessInput(gWindow.windowPtr);
 
+        // images decoded since the last frame replace their placeholders
+        UUpdateTextures(mesh, false);
+
         // Render this frame
         URender(mesh);
 
+        if (firstFrame) {
+            cout << "INFO: First frame after " << glfwGetTime() * 1000.0 << " ms" << endl;
+            firstFrame = false;
+        }
+
         glfwPollEvents();
 
         double currentTime = glfwGetTime();
@@ -1726,10 +1716,8 @@ int main(int argc, char* argv[])
     // Release mesh data
     UDestroyMesh(mesh);
 
-    // Release shader program
-    delete mesh.lightingProgram;
-    delete mesh.textureProgram;
-    delete mesh.defaultProgram;
+    // Release shader programs
+    delete shaderLibrary;
 
     exit(EXIT_SUCCESS); // Terminates the program successfully
 }
@@ -1817,16 +1805,26 @@ void UProcessInput(GLFWwindow* window)
         // toggle projection mode 
         if (gWindow.ProjectionMode == WindowProjection::Perspective) {
             // Creates a orthographic projection
-            gWindow.Projection = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 100.0f);
+            gWindow.Projection = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, NEAR_PLANE, FAR_PLANE);
             gWindow.ProjectionMode = WindowProjection::Orthographic;
         }
         else {
             // create a persective projection
-            gWindow.Projection = glm::perspective(glm::radians(gCamera.Fov), (GLfloat)gWindow.Width / (GLfloat)gWindow.Height, 0.1f, 100.0f);
+            gWindow.Projection = glm::perspective(glm::radians(gCamera.Fov), (GLfloat)gWindow.Width / (GLfloat)gWindow.Height, NEAR_PLANE, FAR_PLANE);
             gWindow.ProjectionMode = WindowProjection::Perspective;
         }
     }
 
+    // report how many binds and uniform uploads were filtered out, once per key press
+    static bool statsKeyDown = false;
+    bool statsKeyPressed = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+    if (statsKeyPressed && !statsKeyDown)
+        cout << "INFO: GL state binds last frame: " << GLStateCache::get().getIssuedCalls() << " issued, "
+             << GLStateCache::get().getSkippedCalls() << " skipped, uniforms: "
+             << GLStateCache::get().getUniformUploads() << " uploaded, "
+             << GLStateCache::get().getUniformSkips() << " unchanged" << endl;
+    statsKeyDown = statsKeyPressed;
+
     //cout << "Camera Pos: " << gCamera.Position.x << ", " << gCamera.Position.y << ", " << gCamera.Position.z;
 }
 
@@ -1894,6 +1892,19 @@ void UResizeWindow(GLFWwindow* window, int width, int height)
 
 void UDestroyMesh(GLMesh& mesh)
 {
-    glDeleteVertexArrays(1, &mesh.vao);
-    glDeleteBuffers(2, mesh.vbos);
+    delete mesh.tessellatedBatch;
+    delete mesh.sceneBatch;
+
+    // each shape holds a reference to its texture, the textures go with the last of them
+    for (MeshHandle shape = 0; shape < mesh.meshRegistry->getCount(); shape++)
+        mesh.textureCache->release(mesh.meshRegistry->getTexture(shape));
+
+    delete mesh.meshRegistry;
+    delete mesh.textureCache;
+    delete mesh.textureLoader;
+    delete mesh.textureArray;
+    delete mesh.scene;
+    delete mesh.meshBuffer;
+    GLStateCache::get().deleteBuffers(1, &mesh.frameUbo);
+    delete mesh.clusteredLights;
 }
\ No newline at end of file
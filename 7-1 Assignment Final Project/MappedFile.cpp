@@ -0,0 +1,64 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// a missing or empty file leaves the mapping closed
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return;
+	file = fileHandle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		return;
+
+	mapping = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+		return;
+
+	data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data != nullptr)
+		size = (size_t)fileSize.QuadPart;
+#else
+	int fileDescriptor = open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return;
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) == 0 && fileStatus.st_size > 0) {
+		void* view = mmap(nullptr, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (view != MAP_FAILED) {
+			data = (const unsigned char*)view;
+			size = (size_t)fileStatus.st_size;
+		}
+	}
+
+	// the mapping keeps its own reference to the file
+	close(fileDescriptor);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	if (file != nullptr)
+		CloseHandle(file);
+#else
+	if (data != nullptr)
+		munmap((void*)data, size);
+#endif
+}
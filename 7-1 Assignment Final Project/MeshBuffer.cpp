@@ -0,0 +1,307 @@
+#include "MeshBuffer.h"
+#include "GLStateCache.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>      // uint64_t
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>     // _mkdir
+#else
+#include <sys/stat.h>   // mkdir
+#endif
+
+const char* MeshBuffer::CacheDirectory = "MeshCache/";
+
+namespace {
+	// one attribute of PackedVertex, recorded in the vertex array and at the front of every cache file
+	struct VertexAttribute {
+		GLuint Location;
+		GLuint Size;
+		GLuint Type;
+		GLuint Normalized;
+		GLuint Offset;
+	};
+
+	const VertexAttribute VertexLayout[] = {
+		{ 0, 3, GL_FLOAT, GL_FALSE, offsetof(PackedVertex, Position) },
+#ifdef _DEBUG
+		{ 1, 3, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(PackedVertex, Color) },		// the lighting shader does not read it
+#endif
+		{ 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, TexCoord) },
+		{ 3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, Normal) }
+	};
+	const GLuint VertexAttributeCount = sizeof(VertexLayout) / sizeof(VertexLayout[0]);
+
+	const char CacheMagic[4] = { 'M', 'E', 'S', 'H' };
+	const GLuint CacheVersion = 1;		// bump when the file layout changes
+	const size_t CacheNameLength = 32;
+
+	// a cache file is this header, the vertex layout, the mesh table, the level of detail table, the vertices and the indices
+	// every part is a multiple of four bytes so the vertices and indices stay aligned in the mapping
+	struct CacheHeader {
+		char Magic[4];
+		GLuint Version;
+		GLuint VertexStride;
+		GLuint AttributeCount;
+		GLuint MeshCount;
+		GLuint RangeCount;
+		GLuint VertexCount;
+		GLuint IndexCount;
+		unsigned long long Key;
+	};
+
+	struct CacheMesh {
+		char Name[CacheNameLength];
+		GLuint FirstRange;		// into the level of detail table, finest first
+		GLuint RangeCount;
+		MeshBounds Bounds;
+	};
+
+	// 64 bit FNV-1a of the generator parameters, the vertex layout and the file version
+	unsigned long long HashKey(const void* key, size_t keySize) {
+		unsigned long long hash = 14695981039346656037ULL;
+		auto hashBytes = [&hash](const void* bytes, size_t size) {
+			for (size_t i = 0; i < size; i++)
+				hash = (hash ^ ((const unsigned char*)bytes)[i]) * 1099511628211ULL;
+		};
+
+		hashBytes(key, keySize);
+		hashBytes(VertexLayout, sizeof(VertexLayout));
+		hashBytes(&CacheVersion, sizeof(CacheVersion));
+
+		return hash;
+	}
+}
+
+MeshBuffer::MeshBuffer() {
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vertexBuffer);
+	glGenBuffers(1, &indexBuffer);
+}
+
+MeshBuffer::~MeshBuffer() {
+	GLuint buffers[] = { vertexBuffer, indexBuffer };
+	GLStateCache::get().deleteBuffers(2, buffers);
+	GLStateCache::get().deleteVertexArrays(1, &vao);
+}
+
+GLuint MeshBuffer::addMesh(const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices, const char* name) {
+	bounds.push_back({ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) });
+	names.push_back(name);
+	levels.push_back({});
+
+	addLevel((GLuint)levels.size() - 1, vertices, indices);
+	return (GLuint)levels.size() - 1;
+}
+
+void MeshBuffer::addLevel(GLuint mesh, const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices) {
+	levels[mesh].push_back(Stage(vertices, indices));
+
+	for (const PackedVertex& vertex : vertices) {
+		glm::vec3 position(vertex.Position[0], vertex.Position[1], vertex.Position[2]);
+		bounds[mesh].Min = glm::min(bounds[mesh].Min, position);
+		bounds[mesh].Max = glm::max(bounds[mesh].Max, position);
+	}
+}
+
+GLuint MeshBuffer::findMesh(const char* name) const {
+	for (GLuint i = 0; i < (GLuint)names.size(); i++)
+		if (names[i] == name)
+			return i;
+
+	return InvalidMesh;
+}
+
+void MeshBuffer::upload() {
+	vertexCount = (GLuint)stagedVertices.size();
+	indexCount = (GLuint)stagedIndices.size();
+
+	CreateBuffers(stagedVertices.data(), stagedIndices.data());
+
+	// the GPU copy is the only one needed from here on
+	std::vector<PackedVertex>().swap(stagedVertices);
+	std::vector<GLuint>().swap(stagedIndices);
+}
+
+// expects an empty buffer, a file that is missing, stale or written by a build with another vertex layout is a miss
+bool MeshBuffer::loadCache(const void* key, size_t keySize) {
+	MappedFile file(CachePath(key, keySize));
+	if (!file.isOpen() || file.getSize() < sizeof(CacheHeader))
+		return false;
+
+	const unsigned char* data = file.getData();
+	const CacheHeader& header = *(const CacheHeader*)data;
+	if (memcmp(header.Magic, CacheMagic, sizeof(CacheMagic)) != 0 || header.Version != CacheVersion || header.Key != HashKey(key, keySize) ||
+		header.VertexStride != sizeof(PackedVertex) || header.AttributeCount != VertexAttributeCount)
+		return false;
+
+	// the sizes are added up before any pointer is formed from them, a damaged count cannot point outside the file
+	uint64_t expectedSize = sizeof(CacheHeader) + sizeof(VertexAttribute) * (uint64_t)header.AttributeCount +
+		sizeof(CacheMesh) * (uint64_t)header.MeshCount + sizeof(MeshRange) * (uint64_t)header.RangeCount +
+		(uint64_t)header.VertexStride * header.VertexCount + sizeof(GLuint) * (uint64_t)header.IndexCount;
+	if (expectedSize != file.getSize())
+		return false;
+
+	const VertexAttribute* attributes = (const VertexAttribute*)(data + sizeof(CacheHeader));
+	const CacheMesh* meshes = (const CacheMesh*)(attributes + header.AttributeCount);
+	const MeshRange* ranges = (const MeshRange*)(meshes + header.MeshCount);
+	const unsigned char* vertices = (const unsigned char*)(ranges + header.RangeCount);
+	const GLuint* indices = (const GLuint*)(vertices + (size_t)header.VertexStride * header.VertexCount);
+
+	if (memcmp(attributes, VertexLayout, sizeof(VertexLayout)) != 0)
+		return false;
+
+	// the whole table is checked before any mesh is kept, a rejected cache leaves the buffer empty for generation
+	for (GLuint i = 0; i < header.MeshCount; i++) {
+		const CacheMesh& mesh = meshes[i];
+		if (mesh.RangeCount == 0 || (uint64_t)mesh.FirstRange + mesh.RangeCount > header.RangeCount)
+			return false;
+
+		for (GLuint r = mesh.FirstRange; r < mesh.FirstRange + mesh.RangeCount; r++) {
+			const MeshRange& range = ranges[r];
+			if ((uint64_t)range.FirstIndex + range.IndexCount > header.IndexCount ||
+				range.BaseVertex < 0 || (GLuint)range.BaseVertex >= header.VertexCount)
+				return false;
+
+			// a stale or damaged index would have the GPU read past the vertex buffer
+			GLuint largestIndex = 0;
+			for (GLuint index = range.FirstIndex; index < range.FirstIndex + range.IndexCount; index++)
+				largestIndex = std::max(largestIndex, indices[index]);
+			if ((uint64_t)range.BaseVertex + largestIndex >= header.VertexCount)
+				return false;
+		}
+	}
+
+	for (GLuint i = 0; i < header.MeshCount; i++) {
+		const CacheMesh& mesh = meshes[i];
+
+		names.push_back(std::string(mesh.Name, strnlen(mesh.Name, CacheNameLength)));
+		bounds.push_back(mesh.Bounds);
+		levels.push_back(std::vector<MeshRange>(ranges + mesh.FirstRange, ranges + mesh.FirstRange + mesh.RangeCount));
+	}
+
+	vertexCount = header.VertexCount;
+	indexCount = header.IndexCount;
+
+	// the mapped pages go to the driver as they are, nothing is generated or copied into staging vectors
+	CreateBuffers(vertices, indices);
+
+	return true;
+}
+
+// failures only cost the next startup the mesh generation
+void MeshBuffer::saveCache(const void* key, size_t keySize) const {
+	CacheHeader header;
+	memcpy(header.Magic, CacheMagic, sizeof(CacheMagic));
+	header.Version = CacheVersion;
+	header.VertexStride = sizeof(PackedVertex);
+	header.AttributeCount = VertexAttributeCount;
+	header.MeshCount = (GLuint)levels.size();
+	header.RangeCount = 0;
+	header.VertexCount = (GLuint)stagedVertices.size();
+	header.IndexCount = (GLuint)stagedIndices.size();
+	header.Key = HashKey(key, keySize);
+
+	std::vector<CacheMesh> meshes(levels.size());
+	std::vector<MeshRange> ranges;
+
+	for (size_t i = 0; i < levels.size(); i++) {
+		CacheMesh& mesh = meshes[i];
+		memset(mesh.Name, 0, CacheNameLength);
+		names[i].copy(mesh.Name, CacheNameLength - 1);
+		mesh.FirstRange = (GLuint)ranges.size();
+		mesh.RangeCount = (GLuint)levels[i].size();
+		mesh.Bounds = bounds[i];
+
+		ranges.insert(ranges.end(), levels[i].begin(), levels[i].end());
+	}
+	header.RangeCount = (GLuint)ranges.size();
+
+#ifdef _WIN32
+	_mkdir(CacheDirectory);
+#else
+	mkdir(CacheDirectory, 0755);
+#endif
+
+	std::ofstream file(CachePath(key, keySize), std::ios::binary | std::ios::trunc);
+	if (!file)
+		return;
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)VertexLayout, sizeof(VertexLayout));
+	file.write((const char*)meshes.data(), sizeof(CacheMesh) * meshes.size());
+	file.write((const char*)ranges.data(), sizeof(MeshRange) * ranges.size());
+	file.write((const char*)stagedVertices.data(), sizeof(PackedVertex) * stagedVertices.size());
+	file.write((const char*)stagedIndices.data(), sizeof(GLuint) * stagedIndices.size());
+}
+
+// cache file name from a hash of the generator parameters, parameters that change give a new file
+std::string MeshBuffer::CachePath(const void* key, size_t keySize) const {
+	std::stringstream path;
+	path << CacheDirectory << std::hex << std::setw(16) << std::setfill('0') << HashKey(key, keySize) << ".mesh";
+
+	return path.str();
+}
+
+// vertexCount and indexCount give the sizes of both arrays
+void MeshBuffer::CreateBuffers(const void* vertices, const void* indices) {
+	GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * vertexCount, vertices, GL_STATIC_DRAW);
+	GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// the element binding is vertex array state, CreateVertexArray attaches the buffer
+	GLStateCache::get().bindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint) * indexCount, indices, GL_STATIC_DRAW);
+
+	CreateVertexArray();
+}
+
+MeshRange MeshBuffer::Stage(const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices) {
+	MeshRange range;
+	range.IndexCount = (GLuint)indices.size();
+	range.FirstIndex = (GLuint)stagedIndices.size();
+	range.BaseVertex = (GLint)stagedVertices.size();
+
+	// average over all triangle edges, shared edges counted twice
+	double edgeLengthSum = 0.0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		for (size_t corner = 0; corner < 3; corner++) {
+			const GLfloat* a = vertices[indices[i + corner]].Position;
+			const GLfloat* b = vertices[indices[i + (corner + 1) % 3]].Position;
+			edgeLengthSum += glm::length(glm::vec3(a[0], a[1], a[2]) - glm::vec3(b[0], b[1], b[2]));
+		}
+	}
+	range.EdgeLength = indices.empty() ? 0.0f : (GLfloat)(edgeLengthSum / indices.size());
+
+	stagedVertices.insert(stagedVertices.end(), vertices.begin(), vertices.end());
+	stagedIndices.insert(stagedIndices.end(), indices.begin(), indices.end());
+
+	return range;
+}
+
+void MeshBuffer::bind() const {
+	GLStateCache::get().bindVertexArray(vao);
+}
+
+// record the PackedVertex layout once, drawing then only binds the array
+void MeshBuffer::CreateVertexArray() {
+	GLStateCache::get().bindVertexArray(vao);
+
+	for (const VertexAttribute& attribute : VertexLayout) {
+		glVertexAttribFormat(attribute.Location, attribute.Size, attribute.Type, (GLboolean)attribute.Normalized, attribute.Offset);
+		glVertexAttribBinding(attribute.Location, VertexBinding);
+		GLStateCache::get().enableVertexAttribArray(attribute.Location);
+	}
+
+	glBindVertexBuffer(VertexBinding, vertexBuffer, 0, sizeof(PackedVertex));
+
+	GLStateCache::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	GLStateCache::get().bindVertexArray(0);
+}
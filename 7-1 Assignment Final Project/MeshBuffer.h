@@ -0,0 +1,77 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <string>
+#include <vector>
+
+#include "PackedVertex.h"
+
+// where one level of detail of a mesh lives inside the shared buffers, the parts of an indirect draw command that belong to it
+struct MeshRange {
+    GLuint IndexCount;
+    GLuint FirstIndex;      // in indices from the start of the index buffer
+    GLint  BaseVertex;      // added to every index of the mesh
+    GLfloat EdgeLength;     // average triangle edge length in model space, compared on screen to pick the level
+};
+
+// model space box around every level of detail of a mesh
+struct MeshBounds {
+    glm::vec3 Min;
+    glm::vec3 Max;
+};
+
+// all static geometry in one vertex buffer and one index buffer behind a single vertex array
+// a mesh may have several levels of detail, level 0 is the finest
+class MeshBuffer {
+
+public:
+    MeshBuffer();
+    ~MeshBuffer();
+
+    // behavior
+    // appends a mesh to the staging copy and returns its id, indices are relative to its own vertices
+    GLuint addMesh(const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices, const char* name);
+    // appends a coarser level of detail to a mesh added before
+    void addLevel(GLuint mesh, const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices);
+    // creates the GL buffers from every mesh added and releases the staging copy
+    void upload();
+    // maps the cache file written for the same generator parameters and uploads straight from it, false on a miss
+    bool loadCache(const void* key, size_t keySize);
+    // writes the staged meshes for the generator parameters in key, call before upload releases them
+    void saveCache(const void* key, size_t keySize) const;
+    void bind() const;
+
+    // accessors
+    const MeshRange& getRange(GLuint mesh, GLuint level = 0) const { return levels[mesh][level]; }
+    GLuint getLevelCount(GLuint mesh) const { return (GLuint)levels[mesh].size(); }
+    const MeshBounds& getBounds(GLuint mesh) const { return bounds[mesh]; }
+    // id of the mesh added under name, InvalidMesh when there is none
+    GLuint findMesh(const char* name) const;
+    GLuint getMeshCount() const { return (GLuint)levels.size(); }
+    GLuint getVertexCount() const { return vertexCount; }
+    GLuint getIndexCount() const { return indexCount; }
+
+    static const GLuint VertexBinding = 0;     // vertex buffer binding of the PackedVertex stream, others are free for instance data
+    static const GLuint InvalidMesh = ~0u;
+    static const char* CacheDirectory;
+
+private:
+
+    GLuint vao = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLuint vertexCount = 0;
+    GLuint indexCount = 0;
+
+    std::vector<std::vector<MeshRange>> levels;    // per mesh, finest first
+    std::vector<MeshBounds> bounds;
+    std::vector<std::string> names;
+    std::vector<PackedVertex> stagedVertices;
+    std::vector<GLuint> stagedIndices;
+
+    MeshRange Stage(const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices);
+    void CreateBuffers(const void* vertices, const void* indices);
+    void CreateVertexArray();
+    std::string CachePath(const void* key, size_t keySize) const;
+};
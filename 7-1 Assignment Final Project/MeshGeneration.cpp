@@ -0,0 +1,114 @@
+#include "MeshGeneration.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86_FP) || defined(__SSE2__)
+#define MESH_GENERATION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// the turn is removed in two parts so large angles keep their low bits
+	const float TwoPiHigh = 6.28125f;
+	const float TwoPiLow = 1.9353071795864769e-3f;
+	const float InverseTwoPi = 0.159154943f;
+	const float Pi = 3.14159265f;
+	const float HalfPi = 1.57079633f;
+
+	// Taylor terms up to x^11 and x^12, below float precision over [-pi/2, pi/2]
+	const float Sin3 = -1.0f / 6.0f, Sin5 = 1.0f / 120.0f, Sin7 = -1.0f / 5040.0f, Sin9 = 1.0f / 362880.0f, Sin11 = -1.0f / 39916800.0f;
+	const float Cos2 = -1.0f / 2.0f, Cos4 = 1.0f / 24.0f, Cos6 = -1.0f / 720.0f, Cos8 = 1.0f / 40320.0f, Cos10 = -1.0f / 3628800.0f, Cos12 = 1.0f / 479001600.0f;
+
+	// the scalar path of the vector code, same reduction and polynomials so both give the same vertices
+	void SinCos(float angle, float& sine, float& cosine) {
+		float turns = std::nearbyint(angle * InverseTwoPi);
+		float x = (angle - turns * TwoPiHigh) - turns * TwoPiLow;     // [-pi, pi]
+
+		// fold onto [-pi/2, pi/2] where the series converge quickly, the fold flips the cosine
+		float cosineSign = 1.0f;
+		if (x > HalfPi) {
+			x = Pi - x;
+			cosineSign = -1.0f;
+		}
+		else if (x < -HalfPi) {
+			x = -Pi - x;
+			cosineSign = -1.0f;
+		}
+
+		float x2 = x * x;
+		sine = x + x * x2 * (Sin3 + x2 * (Sin5 + x2 * (Sin7 + x2 * (Sin9 + x2 * Sin11))));
+		cosine = cosineSign * (1.0f + x2 * (Cos2 + x2 * (Cos4 + x2 * (Cos6 + x2 * (Cos8 + x2 * (Cos10 + x2 * Cos12))))));
+	}
+
+#ifdef MESH_GENERATION_SSE2
+	inline __m128 Polynomial(__m128 x2, __m128 value, float coefficient) {
+		return _mm_add_ps(_mm_set1_ps(coefficient), _mm_mul_ps(x2, value));
+	}
+
+	// four angles at once, branches of the scalar fold become masks
+	void SinCos4(const float* angles, float* sines, float* cosines) {
+		__m128 angle = _mm_loadu_ps(angles);
+
+		__m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(InverseTwoPi))));   // rounds to nearest
+		__m128 x = _mm_sub_ps(_mm_sub_ps(angle, _mm_mul_ps(turns, _mm_set1_ps(TwoPiHigh))), _mm_mul_ps(turns, _mm_set1_ps(TwoPiLow)));
+
+		__m128 above = _mm_cmpgt_ps(x, _mm_set1_ps(HalfPi));
+		__m128 below = _mm_cmplt_ps(x, _mm_set1_ps(-HalfPi));
+		__m128 folded = _mm_or_ps(_mm_and_ps(above, _mm_sub_ps(_mm_set1_ps(Pi), x)), _mm_and_ps(below, _mm_sub_ps(_mm_set1_ps(-Pi), x)));
+		__m128 fold = _mm_or_ps(above, below);
+		x = _mm_or_ps(_mm_and_ps(fold, folded), _mm_andnot_ps(fold, x));
+		__m128 cosineSign = _mm_and_ps(fold, _mm_set1_ps(-0.0f));     // sign bit where folded
+
+		__m128 x2 = _mm_mul_ps(x, x);
+
+		__m128 sine = _mm_set1_ps(Sin11);
+		sine = Polynomial(x2, sine, Sin9);
+		sine = Polynomial(x2, sine, Sin7);
+		sine = Polynomial(x2, sine, Sin5);
+		sine = Polynomial(x2, sine, Sin3);
+		sine = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2), sine));
+
+		__m128 cosine = _mm_set1_ps(Cos12);
+		cosine = Polynomial(x2, cosine, Cos10);
+		cosine = Polynomial(x2, cosine, Cos8);
+		cosine = Polynomial(x2, cosine, Cos6);
+		cosine = Polynomial(x2, cosine, Cos4);
+		cosine = Polynomial(x2, cosine, Cos2);
+		cosine = Polynomial(x2, cosine, 1.0f);
+		cosine = _mm_xor_ps(cosine, cosineSign);
+
+		_mm_storeu_ps(sines, sine);
+		_mm_storeu_ps(cosines, cosine);
+	}
+#endif
+}
+
+void USinCos(const GLfloat* angles, GLfloat* sines, GLfloat* cosines, size_t count) {
+	size_t i = 0;
+
+#ifdef MESH_GENERATION_SSE2
+	for (; i + 4 <= count; i += 4)
+		SinCos4(angles + i, sines + i, cosines + i);
+#endif
+
+	for (; i < count; i++)
+		SinCos(angles[i], sines[i], cosines[i]);
+}
+
+void USinCosTable(GLuint steps, std::vector<GLfloat>& sines, std::vector<GLfloat>& cosines) {
+	const GLfloat angleStep = glm::two_pi<float>() / steps;
+
+	std::vector<GLfloat> angles(steps + 1);
+	for (GLuint i = 0; i <= steps; i++)
+		angles[i] = i * angleStep;
+
+	sines.resize(steps + 1);
+	cosines.resize(steps + 1);
+	USinCos(angles.data(), sines.data(), cosines.data(), angles.size());
+
+	// exactly the first so the seam vertices of a ring coincide
+	sines[steps] = sines[0];
+	cosines[steps] = cosines[0];
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <vector>
+
+// trigonometry shared by the parametric mesh generators, every ring of a shape reuses one table of angles
+
+// sine and cosine of count angles within a few turns of zero, four at a time with SSE2 and one at a time otherwise
+void USinCos(const GLfloat* angles, GLfloat* sines, GLfloat* cosines, size_t count);
+
+// sine and cosine of the steps + 1 angles i * 2pi / steps, the last repeating the first for the seam of a ring
+void USinCosTable(GLuint steps, std::vector<GLfloat>& sines, std::vector<GLfloat>& cosines);
@@ -0,0 +1,188 @@
+#include "MeshIndexing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+namespace {
+	const int OptimizerCacheSize = 32;		// modelled LRU cache, larger than the hardware's so the order suits any size
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	// recently used vertices score high, vertices with few remaining triangles get a boost so they are finished off
+	float VertexScore(int cachePosition, int remainingTriangles) {
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3)
+				score = LastTriangleScore;	// used by the last triangle, the fixed score avoids favouring any of its edges
+			else
+				score = std::pow(1.0f - (cachePosition - 3) / (float)(OptimizerCacheSize - 3), CacheDecayPower);
+		}
+
+		return score + ValenceBoostScale * std::pow((float)remainingTriangles, -ValenceBoostPower);
+	}
+}
+
+void UAppendListIndices(std::vector<GLuint>& indices, GLuint first, GLuint count) {
+	for (GLuint i = 0; i < count; i++)
+		indices.push_back(first + i);
+}
+
+void UAppendStripIndices(std::vector<GLuint>& indices, GLuint first, GLuint count) {
+	for (GLuint i = 0; i + 2 < count; i++) {
+		if (i % 2 == 0) {
+			indices.push_back(first + i);
+			indices.push_back(first + i + 1);
+		}
+		else {
+			indices.push_back(first + i + 1);
+			indices.push_back(first + i);
+		}
+		indices.push_back(first + i + 2);
+	}
+}
+
+void UAppendFanIndices(std::vector<GLuint>& indices, GLuint first, GLuint count) {
+	for (GLuint i = 1; i + 1 < count; i++) {
+		indices.push_back(first);
+		indices.push_back(first + i);
+		indices.push_back(first + i + 1);
+	}
+}
+
+void UOptimizeVertexCache(std::vector<GLuint>& indices, GLuint vertexCount) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// triangles using each vertex, as offsets into one flat list
+	std::vector<int> remaining(vertexCount, 0);
+	for (GLuint index : indices)
+		remaining[index]++;
+
+	std::vector<int> adjacencyOffset(vertexCount + 1, 0);
+	for (GLuint v = 0; v < vertexCount; v++)
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+
+	std::vector<int> adjacency(indices.size());
+	std::vector<int> adjacencyFill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+		for (int corner = 0; corner < 3; corner++)
+			adjacency[adjacencyFill[indices[t * 3 + corner]]++] = (int)t;
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (GLuint v = 0; v < vertexCount; v++)
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	std::vector<GLuint> ordered;
+	ordered.reserve(indices.size());
+
+	std::vector<GLuint> cache;
+	cache.reserve(OptimizerCacheSize + 3);
+
+	size_t scanCursor = 0;		// every triangle before it has been emitted
+	int best = -1;
+
+	while (ordered.size() < indices.size()) {
+		// nothing in the cache is connected to a remaining triangle, take the best one left anywhere
+		if (best < 0) {
+			while (emitted[scanCursor])
+				scanCursor++;
+
+			best = (int)scanCursor;
+			for (size_t t = scanCursor; t < triangleCount; t++)
+				if (!emitted[t] && triangleScore[t] > triangleScore[best])
+					best = (int)t;
+		}
+
+		emitted[best] = true;
+
+		// emit the triangle and move its vertices to the front of the cache
+		std::vector<GLuint> newCache;
+		newCache.reserve(OptimizerCacheSize + 3);
+
+		for (int corner = 0; corner < 3; corner++) {
+			GLuint v = indices[best * 3 + corner];
+			ordered.push_back(v);
+			newCache.push_back(v);
+
+			remaining[v]--;
+			int* first = &adjacency[adjacencyOffset[v]];
+			int* last = first + remaining[v] + 1;
+			*std::find(first, last, best) = *(last - 1);	// keep the remaining triangles at the front
+		}
+
+		for (GLuint v : cache)
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				newCache.push_back(v);
+
+		// vertices pushed out of the cache lose their position and the score it gave their triangles
+		for (size_t i = OptimizerCacheSize; i < newCache.size(); i++) {
+			GLuint v = newCache[i];
+			cachePosition[v] = -1;
+			vertexScore[v] = VertexScore(-1, remaining[v]);
+
+			for (int j = 0; j < remaining[v]; j++) {
+				int t = adjacency[adjacencyOffset[v] + j];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+			}
+		}
+
+		newCache.resize(std::min(newCache.size(), (size_t)OptimizerCacheSize));
+		cache.swap(newCache);
+
+		// rescore what the cache holds and pick the next triangle among those it touches
+		for (size_t i = 0; i < cache.size(); i++) {
+			cachePosition[cache[i]] = (int)i;
+			vertexScore[cache[i]] = VertexScore((int)i, remaining[cache[i]]);
+		}
+
+		best = -1;
+		float bestScore = -1.0f;
+
+		for (GLuint v : cache) {
+			for (int i = 0; i < remaining[v]; i++) {
+				int t = adjacency[adjacencyOffset[v] + i];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+	}
+
+	indices.swap(ordered);
+}
+
+GLfloat UComputeACMR(const std::vector<GLuint>& indices, GLuint cacheSize) {
+	if (indices.size() < 3)
+		return 0.0f;
+
+	std::deque<GLuint> cache;
+	size_t misses = 0;
+
+	for (GLuint index : indices) {
+		if (std::find(cache.begin(), cache.end(), index) != cache.end())
+			continue;
+
+		misses++;
+		cache.push_back(index);
+		if (cache.size() > cacheSize)
+			cache.pop_front();
+	}
+
+	return (GLfloat)misses / (GLfloat)(indices.size() / 3);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <vector>
+
+// triangle list indices for shapes built as strips and fans, and their post-transform vertex cache order
+
+// appends the triangles of a list of count vertices starting at first, for shapes whose vertices are not shared
+void UAppendListIndices(std::vector<GLuint>& indices, GLuint first, GLuint count);
+
+// appends the triangles of a strip of count vertices starting at first, keeping the strip's winding
+void UAppendStripIndices(std::vector<GLuint>& indices, GLuint first, GLuint count);
+
+// appends the triangles of a fan of count vertices whose center is first
+void UAppendFanIndices(std::vector<GLuint>& indices, GLuint first, GLuint count);
+
+// reorders the triangles of a list for a small vertex cache, Tom Forsyth's linear speed algorithm
+void UOptimizeVertexCache(std::vector<GLuint>& indices, GLuint vertexCount);
+
+// average cache miss ratio, vertices transformed per triangle with a FIFO cache of cacheSize entries
+GLfloat UComputeACMR(const std::vector<GLuint>& indices, GLuint cacheSize);
@@ -0,0 +1,40 @@
+#include "MeshRegistry.h"
+
+MeshRegistry::MeshRegistry(const MeshBuffer& meshBuffer)
+	: meshBuffer(meshBuffer) {
+}
+
+MeshHandle MeshRegistry::add(const char* name, GLuint mesh, TextureSlot texture) {
+	return Add(name, mesh, texture, ParametricSurface::Count, glm::vec2(0.0f), meshBuffer.getBounds(mesh));
+}
+
+MeshHandle MeshRegistry::addParametric(const char* name, GLuint mesh, TextureSlot texture, ParametricSurface surface, const glm::vec2& size) {
+	if (mesh != MeshBuffer::InvalidMesh)
+		return Add(name, mesh, texture, surface, size, meshBuffer.getBounds(mesh));
+
+	// without baked levels the bounds follow from the surface, both shapes are built around the z axis
+	glm::vec3 extent = surface == ParametricSurface::Torus
+		? glm::vec3(size.x + size.y, size.x + size.y, size.y)
+		: glm::vec3(size.x, size.x, size.y / 2.0f);
+
+	return Add(name, mesh, texture, surface, size, { -extent, extent });
+}
+
+MeshHandle MeshRegistry::find(const char* name) const {
+	for (MeshHandle handle = 0; handle < (MeshHandle)names.size(); handle++)
+		if (names[handle] == name)
+			return handle;
+
+	return InvalidHandle;
+}
+
+MeshHandle MeshRegistry::Add(const char* name, GLuint mesh, TextureSlot texture, ParametricSurface surface, const glm::vec2& size, const MeshBounds& meshBounds) {
+	names.push_back(name);
+	meshes.push_back(mesh);
+	textures.push_back(texture);
+	bounds.push_back(meshBounds);
+	surfaces.push_back(surface);
+	surfaceSizes.push_back(size);
+
+	return (MeshHandle)names.size() - 1;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "MeshBuffer.h"
+#include "TessellatedBatch.h"
+#include "TextureArray.h"
+
+typedef GLuint MeshHandle;      // index of a record in the registry
+
+// every shape the scene can place, one record per shape kept in parallel arrays addressed by handle
+// a record names the mesh holding its levels of detail in the mesh buffer, its bounds and its texture slot,
+// and for the torus and cylinders the surface the tessellated path evaluates in place of the baked levels
+class MeshRegistry {
+
+public:
+    static const MeshHandle InvalidHandle = ~0u;
+
+    MeshRegistry(const MeshBuffer& meshBuffer);
+
+    // behavior
+    // registers a shape drawn from a mesh of the buffer
+    MeshHandle add(const char* name, GLuint mesh, TextureSlot texture);
+    // registers a torus or cylinder, mesh is MeshBuffer::InvalidMesh when no levels were baked for it
+    MeshHandle addParametric(const char* name, GLuint mesh, TextureSlot texture, ParametricSurface surface, const glm::vec2& size);
+    // handle of the shape registered under name, InvalidHandle when there is none
+    MeshHandle find(const char* name) const;
+
+    // accessors
+    GLuint getCount() const { return (GLuint)names.size(); }
+    const std::string& getName(MeshHandle handle) const { return names[handle]; }
+    GLuint getMesh(MeshHandle handle) const { return meshes[handle]; }
+    TextureSlot getTexture(MeshHandle handle) const { return textures[handle]; }
+    const MeshBounds& getBounds(MeshHandle handle) const { return bounds[handle]; }
+    bool isParametric(MeshHandle handle) const { return surfaces[handle] != ParametricSurface::Count; }
+    ParametricSurface getSurface(MeshHandle handle) const { return surfaces[handle]; }
+    const glm::vec2& getSurfaceSize(MeshHandle handle) const { return surfaceSizes[handle]; }
+
+private:
+    const MeshBuffer& meshBuffer;
+
+    std::vector<std::string> names;
+    std::vector<GLuint> meshes;
+    std::vector<TextureSlot> textures;
+    std::vector<MeshBounds> bounds;
+    std::vector<ParametricSurface> surfaces;    // ParametricSurface::Count for shapes only drawn from their mesh
+    std::vector<glm::vec2> surfaceSizes;        // torus ring and tube radius, or cylinder radius and height
+
+    MeshHandle Add(const char* name, GLuint mesh, TextureSlot texture, ParametricSurface surface, const glm::vec2& size, const MeshBounds& meshBounds);
+};
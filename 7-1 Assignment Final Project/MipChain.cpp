@@ -0,0 +1,117 @@
+#include "MipChain.h"
+
+#include <algorithm>
+#include <cmath>       // floor
+#include <vector>
+
+namespace {
+	struct Tap {
+		int Index;
+		float Weight;
+	};
+
+	// the source pixels and weights each target pixel of one axis is made from, first is where each one's taps start
+	void ResampleTaps(int sourceSize, int targetSize, std::vector<Tap>& taps, std::vector<size_t>& first) {
+		const float ratio = (float)sourceSize / targetSize;
+
+		for (int i = 0; i < targetSize; i++) {
+			first.push_back(taps.size());
+
+			if (ratio > 1.0f) {
+				// the overlap of each source pixel with the target pixel's span, normalized by the span
+				const float start = i * ratio, end = (i + 1) * ratio;
+				for (int s = (int)start; s < sourceSize && s < end; s++)
+					taps.push_back({ s, (std::min(end, s + 1.0f) - std::max(start, (float)s)) / ratio });
+			}
+			else {
+				const float center = (i + 0.5f) * ratio - 0.5f;
+				const int s = (int)std::floor(center);
+				const float f = center - s;
+				taps.push_back({ std::min(std::max(s, 0), sourceSize - 1), 1.0f - f });
+				taps.push_back({ std::min(std::max(s + 1, 0), sourceSize - 1), f });
+			}
+		}
+		first.push_back(taps.size());
+	}
+}
+
+unsigned int UMipLevelCount(int width, int height) {
+	unsigned int levels = 1;
+	while (width > 1 || height > 1) {
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		levels++;
+	}
+	return levels;
+}
+
+size_t UMipChainSize(int width, int height, int channels) {
+	size_t size = 0;
+	while (width > 1 || height > 1) {
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		size += (size_t)width * height * channels;
+	}
+	return size;
+}
+
+void UDownsampleBox(const unsigned char* source, int sourceWidth, int sourceHeight, unsigned char* target, int channels) {
+	int width = std::max(sourceWidth / 2, 1);
+	int height = std::max(sourceHeight / 2, 1);
+
+	for (int y = 0; y < height; y++) {
+		const unsigned char* row0 = source + (size_t)std::min(y * 2, sourceHeight - 1) * sourceWidth * channels;
+		const unsigned char* row1 = source + (size_t)std::min(y * 2 + 1, sourceHeight - 1) * sourceWidth * channels;
+
+		for (int x = 0; x < width; x++) {
+			int x0 = std::min(x * 2, sourceWidth - 1) * channels;
+			int x1 = std::min(x * 2 + 1, sourceWidth - 1) * channels;
+
+			for (int c = 0; c < channels; c++)
+				*target++ = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+		}
+	}
+}
+
+void UBuildMipChain(const unsigned char* pixels, int width, int height, int channels, unsigned char* chain) {
+	const unsigned char* source = pixels;
+
+	// each level is filtered from the one above, not from the image
+	while (width > 1 || height > 1) {
+		UDownsampleBox(source, width, height, chain, channels);
+
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		source = chain;
+		chain += (size_t)width * height * channels;
+	}
+}
+
+void UResampleBox(const unsigned char* source, int sourceWidth, int sourceHeight, unsigned char* target, int targetWidth, int targetHeight, int channels) {
+	std::vector<Tap> columnTaps, rowTaps;
+	std::vector<size_t> columnFirst, rowFirst;
+	ResampleTaps(sourceWidth, targetWidth, columnTaps, columnFirst);
+	ResampleTaps(sourceHeight, targetHeight, rowTaps, rowFirst);
+
+	// every source row scaled across first, then the columns of the result scaled down or up
+	std::vector<float> rows((size_t)sourceHeight * targetWidth * channels, 0.0f);
+	for (int y = 0; y < sourceHeight; y++) {
+		const unsigned char* sourceRow = source + (size_t)y * sourceWidth * channels;
+		float* row = rows.data() + (size_t)y * targetWidth * channels;
+
+		for (int x = 0; x < targetWidth; x++)
+			for (size_t t = columnFirst[x]; t < columnFirst[x + 1]; t++)
+				for (int c = 0; c < channels; c++)
+					row[x * channels + c] += sourceRow[columnTaps[t].Index * channels + c] * columnTaps[t].Weight;
+	}
+
+	for (int y = 0; y < targetHeight; y++) {
+		for (int x = 0; x < targetWidth * channels; x++) {
+			float value = 0.0f;
+			for (size_t t = rowFirst[y]; t < rowFirst[y + 1]; t++)
+				value += rows[(size_t)rowTaps[t].Index * targetWidth * channels + x] * rowTaps[t].Weight;
+
+			*target++ = (unsigned char)std::min(std::max(value + 0.5f, 0.0f), 255.0f);
+		}
+	}
+}
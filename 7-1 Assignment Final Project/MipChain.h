@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+// box filtered mip chains of 8 bit images, shared by the texture loader and the texcook tool
+
+// levels down to 1 x 1 including the image itself, each half the size of the one above rounded down
+unsigned int UMipLevelCount(int width, int height);
+
+// bytes of every level below the image, tightly packed one after another
+size_t UMipChainSize(int width, int height, int channels);
+
+// averages each 2 x 2 block of the level above into target, the last row or column of an odd size is repeated
+void UDownsampleBox(const unsigned char* source, int sourceWidth, int sourceHeight, unsigned char* target, int channels);
+
+// fills chain, UMipChainSize bytes, with every level below the image
+void UBuildMipChain(const unsigned char* pixels, int width, int height, int channels, unsigned char* chain);
+
+// scales the image to targetWidth x targetHeight, each target pixel the average of the source area it covers when
+// shrinking and bilinear between the nearest source pixels when growing
+void UResampleBox(const unsigned char* source, int sourceWidth, int sourceHeight, unsigned char* target, int targetWidth, int targetHeight, int channels);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <vector>
+#include <cstddef>          // offsetof
+
+// interleaved vertex as stored in the vertex buffers, 20 bytes instead of 11 floats
+struct PackedVertex {
+    GLfloat  Position[3];       // GL_FLOAT
+    GLuint   Normal;            // GL_INT_2_10_10_10_REV, normalized
+    GLushort TexCoord[2];       // GL_HALF_FLOAT
+#ifdef _DEBUG
+    GLubyte  Color[4];          // gColorMap debug color, the lighting shader does not read it
+#endif
+};
+
+// builds a packed vertex from the full precision attributes the generators compute
+inline PackedVertex UPackVertex(const glm::vec3& position, const glm::vec3& color, const glm::vec2& textureCoordinate, const glm::vec3& normal)
+{
+    PackedVertex vertex;
+
+    vertex.Position[0] = position.x;
+    vertex.Position[1] = position.y;
+    vertex.Position[2] = position.z;
+    vertex.Normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+    vertex.TexCoord[0] = glm::packHalf1x16(textureCoordinate.x);
+    vertex.TexCoord[1] = glm::packHalf1x16(textureCoordinate.y);
+#ifdef _DEBUG
+    glm::uvec3 color8 = glm::uvec3(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+    vertex.Color[0] = (GLubyte)color8.r;
+    vertex.Color[1] = (GLubyte)color8.g;
+    vertex.Color[2] = (GLubyte)color8.b;
+    vertex.Color[3] = 255;
+#else
+    (void)color;                // only debug builds keep the color
+#endif
+
+    return vertex;
+}
+
+// packs a literal table of position, color, texture and normal floats, 11 per vertex
+inline void UPackVertices(const GLfloat* values, size_t vertexCount, std::vector<PackedVertex>& vertices)
+{
+    vertices.reserve(vertices.size() + vertexCount);
+
+    for (size_t i = 0; i < vertexCount; i++, values += 11)
+        vertices.push_back(UPackVertex(glm::vec3(values[0], values[1], values[2]), glm::vec3(values[3], values[4], values[5]),
+                                       glm::vec2(values[6], values[7]), glm::vec3(values[8], values[9], values[10])));
+}
@@ -0,0 +1,218 @@
+#include "Scene.h"
+#include "MappedFile.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+	const char BinaryTag[4] = { 'S', 'C', 'N', 'B' };
+	const GLuint BinaryVersion = 1;
+	const size_t BinaryNameLength = 32;
+
+	// a binary scene is this header, the key light, the shape names, the objects and the point lights
+	struct BinaryHeader {
+		char Tag[4];
+		GLuint Version;
+		GLuint ShapeCount;
+		GLuint ObjectCount;
+		GLuint PointLightCount;
+	};
+
+	bool ReadVector(std::istream& stream, glm::vec3& value) {
+		return (bool)(stream >> value.x >> value.y >> value.z);
+	}
+
+	// a shape name in double quotes, names may hold spaces
+	bool ReadQuoted(std::istream& stream, std::string& value) {
+		char quote = 0;
+		if (!(stream >> quote) || quote != '"')
+			return false;
+
+		return (bool)std::getline(stream, value, '"');
+	}
+}
+
+Scene::Scene() {
+	Clear();
+}
+
+bool Scene::load(const std::string& path) {
+	MappedFile file(path);
+	if (!file.isOpen()) {
+		std::cout << "ERROR::SCENE::FILE_NOT_FOUND " << path << std::endl;
+		return false;
+	}
+
+	Clear();
+
+	bool loaded = file.getSize() >= sizeof(BinaryTag) && memcmp(file.getData(), BinaryTag, sizeof(BinaryTag)) == 0
+		? LoadBinary(file.getData(), file.getSize(), path)
+		: LoadText(path);
+
+	if (!loaded)
+		Clear();
+	return loaded;
+}
+
+bool Scene::saveBinary(const std::string& path) const {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	BinaryHeader header;
+	memcpy(header.Tag, BinaryTag, sizeof(BinaryTag));
+	header.Version = BinaryVersion;
+	header.ShapeCount = (GLuint)shapes.size();
+	header.ObjectCount = (GLuint)objects.size();
+	header.PointLightCount = (GLuint)pointLights.size();
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&keyLight, sizeof(keyLight));
+
+	for (const std::string& shape : shapes) {
+		char name[BinaryNameLength] = {};
+		shape.copy(name, BinaryNameLength - 1);
+		file.write(name, BinaryNameLength);
+	}
+
+	file.write((const char*)objects.data(), sizeof(SceneObject) * objects.size());
+	file.write((const char*)pointLights.data(), sizeof(PointLight) * pointLights.size());
+
+	return (bool)file;
+}
+
+glm::mat4 Scene::getModel(const SceneObject& object) const {
+	// transformations are applied right-to-left order
+	return glm::translate(object.Translation)
+		* glm::rotate(glm::radians(object.Rotation.x), glm::vec3(object.Rotation.y, object.Rotation.z, object.Rotation.w))
+		* glm::scale(object.Scale);
+}
+
+bool Scene::LoadText(const std::string& path) {
+	std::ifstream file(path);
+	std::string line;
+	int lineNumber = 0;
+
+	while (std::getline(file, line)) {
+		lineNumber++;
+
+		std::istringstream stream(line);
+		std::string statement;
+		if (!(stream >> statement) || statement[0] == '#')
+			continue;
+
+		bool valid = true;
+
+		if (statement == "keylight")
+			valid = ReadVector(stream, keyLight.Position) && ReadVector(stream, keyLight.Color) && stream >> keyLight.Intensity;
+		else if (statement == "pointlight") {
+			glm::vec3 position, color;
+			GLfloat radius = 0.0f, intensity = 0.0f;
+			valid = ReadVector(stream, position) && stream >> radius && ReadVector(stream, color) && stream >> intensity;
+			pointLights.push_back({ glm::vec4(position, radius), glm::vec4(color, intensity) });
+		}
+		else if (statement == "object") {
+			std::string shape;
+			valid = ReadQuoted(stream, shape);
+
+			SceneObject object;
+			object.Shape = FindShape(shape);
+			object.Translation = glm::vec3(0.0f);
+			object.Rotation = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+			object.Scale = glm::vec3(1.0f);
+			object.Material = glm::vec3(0.1f, 0.8f, 32.0f);
+			object.FillLight = glm::vec4(0.0f);
+			object.FillLightColor = glm::vec3(1.0f);
+			objects.push_back(object);
+		}
+		else if (objects.empty())
+			valid = false;      // every other statement is a property of the last object
+		else {
+			SceneObject& object = objects.back();
+
+			if (statement == "translate")
+				valid = ReadVector(stream, object.Translation);
+			else if (statement == "rotate")
+				valid = stream >> object.Rotation.x >> object.Rotation.y >> object.Rotation.z >> object.Rotation.w &&
+					glm::vec3(object.Rotation.y, object.Rotation.z, object.Rotation.w) != glm::vec3(0.0f);
+			else if (statement == "scale")
+				valid = ReadVector(stream, object.Scale);
+			else if (statement == "material")
+				valid = ReadVector(stream, object.Material);
+			else if (statement == "fill") {
+				glm::vec3 position;
+				valid = ReadVector(stream, position) && ReadVector(stream, object.FillLightColor) && stream >> object.FillLight.w;
+				object.FillLight = glm::vec4(position, object.FillLight.w);
+			}
+			else
+				valid = false;
+		}
+
+		if (!valid) {
+			std::cout << "ERROR::SCENE::PARSE_FAILED " << path << " line " << lineNumber << ": " << line << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// the arrays are copied as they are, only the counts and shape indices are checked
+bool Scene::LoadBinary(const unsigned char* data, size_t size, const std::string& path) {
+	BinaryHeader header = {};
+	memcpy(&header, data, std::min(size, sizeof(header)));
+
+	size_t expectedSize = sizeof(header) + sizeof(KeyLight) + BinaryNameLength * header.ShapeCount +
+		sizeof(SceneObject) * header.ObjectCount + sizeof(PointLight) * header.PointLightCount;
+
+	if (size < sizeof(header) || header.Version != BinaryVersion || size != expectedSize) {
+		std::cout << "ERROR::SCENE::BINARY_MISMATCH " << path << std::endl;
+		return false;
+	}
+
+	const unsigned char* read = data + sizeof(header);
+
+	memcpy(&keyLight, read, sizeof(KeyLight));
+	read += sizeof(KeyLight);
+
+	for (GLuint i = 0; i < header.ShapeCount; i++, read += BinaryNameLength)
+		shapes.push_back(std::string((const char*)read, strnlen((const char*)read, BinaryNameLength)));
+
+	objects.resize(header.ObjectCount);
+	memcpy(objects.data(), read, sizeof(SceneObject) * objects.size());
+	read += sizeof(SceneObject) * objects.size();
+
+	pointLights.resize(header.PointLightCount);
+	memcpy(pointLights.data(), read, sizeof(PointLight) * pointLights.size());
+
+	for (const SceneObject& object : objects) {
+		if (object.Shape >= header.ShapeCount) {
+			std::cout << "ERROR::SCENE::BINARY_MISMATCH " << path << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// index of the shape name, added on first use
+GLuint Scene::FindShape(const std::string& name) {
+	for (GLuint i = 0; i < (GLuint)shapes.size(); i++)
+		if (shapes[i] == name)
+			return i;
+
+	shapes.push_back(name);
+	return (GLuint)shapes.size() - 1;
+}
+
+void Scene::Clear() {
+	shapes.clear();
+	objects.clear();
+	pointLights.clear();
+	keyLight = { glm::vec3(0.0f), glm::vec3(0.0f), 0.0f };
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "ClusteredLights.h"
+
+// one placed shape, the model matrix is translate * rotate * scale
+struct SceneObject {
+    GLuint    Shape;                // index into the scene's shape names
+    glm::vec3 Translation;
+    glm::vec4 Rotation;             // angle in degrees, axis
+    glm::vec3 Scale;
+    glm::vec3 Material;             // ambient strength, specular intensity, highlight size
+    glm::vec4 FillLight;            // position, intensity, zero leaves the fill light off
+    glm::vec3 FillLightColor;
+};
+
+// the light every object is lit by, off when a scene has none
+struct KeyLight {
+    glm::vec3 Position;
+    glm::vec3 Color;
+    GLfloat   Intensity;
+};
+
+// objects, materials and lights read from a scene file
+// the text form is for authoring, one statement per line:
+//     keylight <x y z> <r g b> <intensity>
+//     pointlight <x y z> <radius> <r g b> <intensity>
+//     object "<shape name>"
+// followed by the properties of the object, any of them may be left out:
+//     translate <x y z>
+//     rotate <degrees> <x y z>
+//     scale <x y z>
+//     material <ambient> <specular> <highlight>
+//     fill <x y z> <r g b> <intensity>
+// lines starting with # are comments
+// the binary form holds the same arrays as they are in memory and loads without parsing
+class Scene {
+
+public:
+    Scene();
+
+    // behavior
+    // reads either form, the binary one is recognized by its tag, false after printing what was wrong
+    bool load(const std::string& path);
+    bool saveBinary(const std::string& path) const;
+
+    // accessors
+    const std::vector<std::string>& getShapes() const { return shapes; }
+    const std::vector<SceneObject>& getObjects() const { return objects; }
+    const std::vector<PointLight>& getPointLights() const { return pointLights; }
+    const KeyLight& getKeyLight() const { return keyLight; }
+    glm::mat4 getModel(const SceneObject& object) const;
+
+private:
+    std::vector<std::string> shapes;
+    std::vector<SceneObject> objects;
+    std::vector<PointLight> pointLights;
+    KeyLight keyLight;
+
+    bool LoadText(const std::string& path);
+    bool LoadBinary(const unsigned char* data, size_t size, const std::string& path);
+    GLuint FindShape(const std::string& name);
+    void Clear();
+};
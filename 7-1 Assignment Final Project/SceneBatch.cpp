@@ -0,0 +1,172 @@
+#include "SceneBatch.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+
+SceneBatch::SceneBatch(MeshBuffer& meshBuffer) : meshBuffer(meshBuffer) {
+	glGenBuffers(1, &commandBuffer);
+	glGenBuffers(1, &objectBuffer);
+	glGenBuffers(1, &instanceBuffer);
+
+	// the instance stream shares the mesh buffer's vertex array
+	meshBuffer.bind();
+	formatInstanceAttributes(MeshBuffer::VertexBinding + 1);
+	GLStateCache::get().bindVertexArray(0);
+}
+
+SceneBatch::~SceneBatch() {
+	GLuint buffers[] = { commandBuffer, objectBuffer, instanceBuffer };
+	GLStateCache::get().deleteBuffers(3, buffers);
+}
+
+void SceneBatch::add(GLuint mesh, GLuint texture, const ObjectData& object) {
+	GLfloat scale = glm::max(glm::length(glm::vec3(object.Model[0])), glm::max(glm::length(glm::vec3(object.Model[1])), glm::length(glm::vec3(object.Model[2]))));
+
+	// start coarse, the first update refines what is close
+	objects.push_back({ mesh, texture, object, scale, meshBuffer.getLevelCount(mesh) - 1 });
+}
+
+void SceneBatch::clear() {
+	objects.clear();
+	groups.clear();
+	instances.clear();
+	commands.clear();
+}
+
+void SceneBatch::upload() {
+	// objects sharing a texture become neighbouring commands of one multi draw, and neighbours sharing a mesh instances
+	std::stable_sort(objects.begin(), objects.end(), [](const Object& a, const Object& b) {
+		return a.Texture != b.Texture ? a.Texture < b.Texture : a.Mesh < b.Mesh;
+	});
+
+	std::vector<ObjectData> objectData;
+	objectData.reserve(objects.size());
+	for (const Object& object : objects)
+		objectData.push_back(object.Data);
+
+	Upload(GL_SHADER_STORAGE_BUFFER, objectBuffer, sizeof(ObjectData) * objectData.size(), objectData.data(), GL_STATIC_DRAW);
+}
+
+void SceneBatch::update(const glm::mat4& view, const glm::mat4& projection, GLuint viewportHeight) {
+	glm::mat4 viewProjection = projection * view;
+	bool orthographic = projection[2][3] == 0.0f;
+	GLfloat pixelsPerUnitAtUnitDistance = projection[1][1] * viewportHeight * 0.5f;
+
+	groups.clear();
+	instances.clear();
+	commands.clear();
+	triangleCount = 0;
+
+	// every run of objects sharing texture and mesh gives one command per level of detail in use
+	for (size_t first = 0, last = 0; first < objects.size(); first = last) {
+		GLuint mesh = objects[first].Mesh;
+		GLuint texture = objects[first].Texture;
+		GLuint levelCount = meshBuffer.getLevelCount(mesh);
+
+		for (last = first; last < objects.size() && objects[last].Mesh == mesh && objects[last].Texture == texture; last++) {
+			Object& object = objects[last];
+			GLfloat distance = -(view * object.Data.Model[3]).z;
+			GLfloat pixelsPerUnit = pixelsPerUnitAtUnitDistance * object.Scale / (orthographic ? 1.0f : glm::max(distance, 0.001f));
+			object.Level = SelectLevel(object, pixelsPerUnit);
+		}
+
+		for (GLuint level = 0; level < levelCount; level++) {
+			GLuint firstInstance = (GLuint)instances.size();
+
+			for (size_t i = first; i < last; i++) {
+				if (objects[i].Level != level)
+					continue;
+
+				InstanceData instance;
+				instance.ModelViewProjection = viewProjection * objects[i].Data.Model;
+				instance.Model = objects[i].Data.Model;
+				std::copy(objects[i].Data.NormalMatrix, objects[i].Data.NormalMatrix + 3, instance.NormalMatrix);
+				instance.ObjectIndex = (GLuint)i;
+				instances.push_back(instance);
+			}
+
+			GLuint instanceCount = (GLuint)instances.size() - firstInstance;
+			if (instanceCount == 0)
+				continue;
+
+			const MeshRange& range = meshBuffer.getRange(mesh, level);
+			commands.push_back({ range.IndexCount, instanceCount, range.FirstIndex, range.BaseVertex, firstInstance });
+			triangleCount += range.IndexCount / 3 * instanceCount;
+
+			if (groups.empty() || groups.back().Texture != texture)
+				groups.push_back({ texture, (GLuint)commands.size() - 1, 0 });
+			groups.back().CommandCount++;
+		}
+	}
+
+	// over budget the next frame aims for longer edges everywhere, well under it the scale relaxes back
+	if (triangleBudget != 0 && triangleCount > triangleBudget)
+		edgeScale *= Hysteresis;
+	else if (edgeScale > 1.0f && (triangleBudget == 0 || triangleCount * Hysteresis * Hysteresis < triangleBudget))
+		edgeScale = glm::max(edgeScale / Hysteresis, 1.0f);
+
+	// respecified each frame so the driver can hand out fresh storage instead of waiting on the last frame
+	Upload(GL_DRAW_INDIRECT_BUFFER, commandBuffer, sizeof(DrawElementsIndirectCommand) * commands.size(), commands.data(), GL_STREAM_DRAW);
+	Upload(GL_ARRAY_BUFFER, instanceBuffer, sizeof(InstanceData) * instances.size(), instances.data(), GL_STREAM_DRAW);
+}
+
+void SceneBatch::draw() {
+	// bound here rather than once so several batches can share a mesh buffer
+	GLStateCache::get().bindBufferBase(GL_SHADER_STORAGE_BUFFER, ObjectBinding, objectBuffer);
+
+	meshBuffer.bind();
+	glBindVertexBuffer(MeshBuffer::VertexBinding + 1, instanceBuffer, 0, sizeof(InstanceData));
+
+	GLStateCache::get().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	GLStateCache::get().activeTexture(GL_TEXTURE0);
+
+	for (const TextureGroup& group : groups) {
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, group.Texture);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(sizeof(DrawElementsIndirectCommand) * group.FirstCommand), group.CommandCount, 0);
+	}
+}
+
+// finest level 0 to coarsest, a level is kept until its edges are clearly too long or the next one's clearly short enough
+GLuint SceneBatch::SelectLevel(const Object& object, GLfloat pixelsPerUnit) const {
+	GLuint levelCount = meshBuffer.getLevelCount(object.Mesh);
+	GLfloat target = TargetEdgePixels * edgeScale;
+	GLuint level = glm::min(object.Level, levelCount - 1);
+
+	while (level > 0 && meshBuffer.getRange(object.Mesh, level).EdgeLength * pixelsPerUnit > target * Hysteresis)
+		level--;
+	while (level + 1 < levelCount && meshBuffer.getRange(object.Mesh, level + 1).EdgeLength * pixelsPerUnit < target / Hysteresis)
+		level++;
+
+	return level;
+}
+
+// the instance stream feeds the object index, model-view-projection, model and normal matrix, read as
+// instanced attributes so the vertex shader does not load them from storage buffers
+void SceneBatch::formatInstanceAttributes(GLuint instanceBinding) {
+	glVertexAttribIFormat(ObjectIndexAttribute, 1, GL_UNSIGNED_INT, offsetof(InstanceData, ObjectIndex));
+	glVertexAttribBinding(ObjectIndexAttribute, instanceBinding);
+	GLStateCache::get().enableVertexAttribArray(ObjectIndexAttribute);
+
+	for (GLuint column = 0; column < 4; column++) {
+		glVertexAttribFormat(ModelViewProjectionAttribute + column, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, ModelViewProjection) + sizeof(glm::vec4) * column);
+		glVertexAttribBinding(ModelViewProjectionAttribute + column, instanceBinding);
+		GLStateCache::get().enableVertexAttribArray(ModelViewProjectionAttribute + column);
+
+		glVertexAttribFormat(ModelAttribute + column, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, Model) + sizeof(glm::vec4) * column);
+		glVertexAttribBinding(ModelAttribute + column, instanceBinding);
+		GLStateCache::get().enableVertexAttribArray(ModelAttribute + column);
+	}
+
+	for (GLuint column = 0; column < 3; column++) {
+		glVertexAttribFormat(NormalMatrixAttribute + column, 3, GL_FLOAT, GL_FALSE, offsetof(InstanceData, NormalMatrix) + sizeof(glm::vec4) * column);
+		glVertexAttribBinding(NormalMatrixAttribute + column, instanceBinding);
+		GLStateCache::get().enableVertexAttribArray(NormalMatrixAttribute + column);
+	}
+
+	glVertexBindingDivisor(instanceBinding, 1);
+}
+
+void SceneBatch::Upload(GLenum target, GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) {
+	GLStateCache::get().bindBuffer(target, buffer);
+	glBufferData(target, size, data, usage);
+}
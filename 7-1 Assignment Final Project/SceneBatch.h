@@ -0,0 +1,114 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "MeshBuffer.h"
+
+// per object values as stored in the std430 object buffer read by the lighting shaders
+struct ObjectData {
+    glm::mat4 Model;                // transforms to world space
+    glm::vec4 NormalMatrix[3];      // inverse transpose of the model's upper 3x3, std430 pads each mat3 column to a vec4
+    glm::vec4 Material;             // ambient strength, specular intensity, highlight size, texture array layer
+    glm::vec4 FillLightPosition;    // position, intensity
+    glm::vec4 FillLightColor;       // color, unused
+};
+static_assert(sizeof(ObjectData) == 160, "ObjectData must match the std430 layout of ObjectBuffer");
+
+// per instance values streamed every frame and read as instanced vertex attributes
+struct InstanceData {
+    glm::mat4 ModelViewProjection;  // multiplied on the CPU for the current camera
+    glm::mat4 Model;
+    glm::vec4 NormalMatrix[3];      // only xyz of each column is read
+    GLuint    ObjectIndex;          // entry of the object buffer holding the material
+    GLuint    Padding[3];
+};
+
+// command layout glMultiDrawElementsIndirect reads from the draw indirect buffer
+struct DrawElementsIndirectCommand {
+    GLuint Count;
+    GLuint InstanceCount;
+    GLuint FirstIndex;
+    GLint  BaseVertex;
+    GLuint BaseInstance;            // instance data of the first instance
+};
+
+// the opaque objects of the scene, submitted as one indirect multi draw per texture array
+// objects sharing a mesh, level of detail and texture array become the instances of a single command, the layer each
+// samples is part of its material
+class SceneBatch {
+
+public:
+    static const GLuint ObjectBinding = 4;     // shader storage binding point of the object buffer
+
+    // per instance vertex attributes, all advance once per instance starting at the command's base instance
+    static const GLuint ObjectIndexAttribute = 4;
+    static const GLuint ModelViewProjectionAttribute = 5;  // four columns
+    static const GLuint ModelAttribute = 9;                // four columns
+    static const GLuint NormalMatrixAttribute = 13;        // three columns
+
+    SceneBatch(MeshBuffer& meshBuffer);
+    ~SceneBatch();
+
+    // behavior
+    void add(GLuint mesh, GLuint texture, const ObjectData& object);
+    void clear();
+    // groups the objects by texture and mesh and uploads the object data
+    void upload();
+    // picks each object's level of detail for the camera and rebuilds the instances and indirect commands,
+    // the model-view-projection is multiplied here once per object so vertices need a single matrix product
+    void update(const glm::mat4& view, const glm::mat4& projection, GLuint viewportHeight);
+    // draws every object with the program in use, texture unit 0 holds the object's texture array
+    void draw();
+    // points the instance attributes of the bound vertex array at InstanceData read from instanceBinding
+    static void formatInstanceAttributes(GLuint instanceBinding);
+
+    // accessors
+    GLuint getObjectCount() const { return (GLuint)objects.size(); }
+    GLuint getCommandCount() const { return (GLuint)commands.size(); }
+    GLuint getDrawCallCount() const { return (GLuint)groups.size(); }
+    GLuint getTriangleCount() const { return triangleCount; }  // drawn by the last update
+
+    // mutators
+    // levels coarsen for the whole scene while more triangles than this are drawn, 0 for no limit
+    void setTriangleBudget(GLuint triangles) { triangleBudget = triangles; }
+
+private:
+    struct Object {
+        GLuint Mesh;
+        GLuint Texture;
+        ObjectData Data;
+        GLfloat Scale;              // largest axis scale of the model matrix
+        GLuint Level;               // level of detail drawn last frame
+    };
+
+    // consecutive commands sharing a texture
+    struct TextureGroup {
+        GLuint Texture;
+        GLuint FirstCommand;
+        GLuint CommandCount;
+    };
+
+    MeshBuffer& meshBuffer;
+
+    GLuint commandBuffer = 0;
+    GLuint objectBuffer = 0;
+    GLuint instanceBuffer = 0;
+
+    const GLfloat TargetEdgePixels = 8.0f;     // triangle edge length on screen each object's level aims for
+    const GLfloat Hysteresis = 1.25f;          // a level changes only once it is this far past the target
+    GLfloat edgeScale = 1.0f;                   // above 1 while over the triangle budget
+    GLuint triangleBudget = 0;
+    GLuint triangleCount = 0;
+
+    std::vector<Object> objects;
+    // rebuilt every update, kept between frames so it does not allocate
+    std::vector<TextureGroup> groups;
+    std::vector<InstanceData> instances;
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    GLuint SelectLevel(const Object& object, GLfloat pixelsPerUnit) const;
+    void Upload(GLenum target, GLuint buffer, GLsizeiptr size, const void* data, GLenum usage);
+};
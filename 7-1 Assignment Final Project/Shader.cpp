@@ -1,4 +1,16 @@
 #include "Shader.h"
+#include "GLStateCache.h"
+
+#include <iomanip>
+#include <cstring>
+
+#ifdef _WIN32
+#include <direct.h>     // _mkdir
+#else
+#include <sys/stat.h>   // mkdir
+#endif
+
+const char* Shader::ProgramBinaryCacheDirectory = "ShaderCache/";
 
 const GLchar* Shader::DefaultVertexShaderSource =
 	"#version 440 core"
@@ -92,28 +104,51 @@ const GLchar* Shader::LightingVertexShaderSource =
 	"\nlayout(location = 1) in vec3 color;"					// colors from vbo
 	"\nlayout(location = 2) in vec2 textureCoordinate;"		// texture coords from vbo
 	"\nlayout(location = 3) in vec3 normal;"				// normals from vbo
+	"\nlayout(location = 4) in uint objectIndex;"			// object of the instance, for the fragment shader's material
+	"\nlayout(location = 5) in mat4 modelViewProjection;"	// per instance, multiplied on the CPU each frame
+	"\nlayout(location = 9) in mat4 model;"					// per instance model matrix transforms to world space
+	"\nlayout(location = 13) in mat3 normalMatrix;"			// per instance inverse transpose of the model matrix
 
 	"\nout vec3 vertexNormal;"				// For outgoing normals to fragment shader
 	"\nout vec3 vertexFragmentPos;"			// For outgoing color / pixels to fragment shader
 	"\nout vec2 vertexTextureCoordinate;"	// For outgoing texture coords to fragment shader
+	"\nflat out uint vertexObjectIndex;"		// For the object's material in the fragment shader
 
-	"\nuniform mat4 model;"					// model matrix transforms to world space
-	"\nuniform mat4 view;"					// view matrix transforms to view space
-	"\nuniform mat4 projection;"			// projection matrix transforms to clip space
+	// structure to hold diffuse light properties
+	"\nstruct DiffLight {"
+		"\nvec3 position;"
+		"\nvec3 color;"
+		"\nfloat intensity;"
+	"\n};"
+
+	// camera and key light shared by all objects, written once per frame
+	"\nlayout(std140, binding = 0) uniform FrameBlock {"
+		"\nmat4 view;"						// view matrix transforms to view space
+		"\nmat4 projection;"				// projection matrix transforms to clip space
+		"\nvec3 viewPosition;"				// position of the camera
+		"\nDiffLight keyLight;"				// key light of the scene
+		"\nuvec4 clusterGrid;"				// tiles across, tiles down, depth slices
+		"\nvec4 clusterDepth;"				// depth slice scale and bias, tile size in pixels
+	"\n};"
 
 	"\nvoid main()"
 	"\n{"
-	"\n		gl_Position = projection * view * model * vec4(position, 1.0f);" // transform to clip coordinates
 	"\n		vertexFragmentPos = vec3(model * vec4(position, 1.0f));"		 // fragment position in world space pass to frag shader
+	// the matrices used to be derived here for every vertex, the vertex benchmark still builds that variant to compare
+	"\n#ifdef PER_VERTEX_MATRICES"
+	"\n		gl_Position = projection * view * model * vec4(position, 1.0f);" // transform to clip coordinates
 	"\n		vertexNormal = mat3(transpose(inverse(model))) * normal;"        // normal vectors in world space but remove translation by converting to mat3 pass to frag shader
+	"\n#else"
+	"\n		gl_Position = modelViewProjection * vec4(position, 1.0f);"		 // transform to clip coordinates
+	"\n		vertexNormal = normalMatrix * normal;"							 // normal vectors in world space, the inverse transpose is computed once on the CPU
+	"\n#endif"
 	"\n		vertexTextureCoordinate = textureCoordinate;"					 // pass UV coordinate to frag shader 
+	"\n		vertexObjectIndex = objectIndex;"
 	"\n}";
 
 const GLchar* Shader::LightingFragmentShaderSource =
 	"#version 440 core"
 
-	"\n#define NR_DIFF_LIGHTS 2"		// number of diffuse light sources for computing diffuse and specular
-
 	// structure to hold diffuse light properties
 	"\nstruct DiffLight {"
 		"\nvec3 position;"
@@ -121,55 +156,279 @@ const GLchar* Shader::LightingFragmentShaderSource =
 		"\nfloat intensity;"
 	"\n};"
 
+	// camera and key light shared by all objects, written once per frame
+	"\nlayout(std140, binding = 0) uniform FrameBlock {"
+		"\nmat4 view;"
+		"\nmat4 projection;"
+		"\nvec3 viewPosition;"				// position of the camera
+		"\nDiffLight keyLight;"				// key light of the scene
+		"\nuvec4 clusterGrid;"				// tiles across, tiles down, depth slices
+		"\nvec4 clusterDepth;"				// depth slice scale and bias, tile size in pixels
+	"\n};"
+
+	// point lights sorted into view space clusters on the CPU each frame
+	"\nstruct PointLight {"
+		"\nvec4 positionRadius;"
+		"\nvec4 colorIntensity;"
+	"\n};"
+	"\nlayout(std430, binding = 1) readonly buffer LightBuffer { PointLight pointLights[]; };"
+	"\nlayout(std430, binding = 2) readonly buffer ClusterBuffer { uvec2 clusters[]; };"		// offset into lightIndices, light count
+	"\nlayout(std430, binding = 3) readonly buffer LightIndexBuffer { uint lightIndices[]; };"
+
+	// transform, material and fill light of every object, one per instance of a draw
+	"\nstruct ObjectData {"
+		"\nmat4 model;"
+		"\nmat3 normalMatrix;"				// inverse transpose of the model matrix
+		"\nvec4 material;"					// ambient strength, specular intensity, highlight size, texture array layer
+		"\nvec4 fillLightPosition;"			// position, intensity
+		"\nvec4 fillLightColor;"
+	"\n};"
+	"\nlayout(std430, binding = 4) readonly buffer ObjectBuffer { ObjectData objects[]; };"
+
 	"\nin vec3 vertexNormal;"				// For incoming normals 
 	"\nin vec3 vertexFragmentPos;"			// For incoming fragment position
 	"\nin vec2 vertexTextureCoordinate;"	// U V coordinate
+	"\nflat in uint vertexObjectIndex;"		// object being shaded
 
 	"\nout vec4 fragmentColor;"				// output color to GPU
 
-	// Uniform / Global variables for object color, light color, light position, and camera/view position
-	"\nuniform float ambientStrength;"		// ambient strength
-	"\nuniform float specularIntensity;"	// specular strength
-	"\nuniform float highlightSize;"		// specular size (pow)
-	"\nuniform vec3 viewPosition;"			// position of the camera
-	"\nuniform sampler2D uTexture;"			// texture unit
-	"\nuniform DiffLight diffLights[NR_DIFF_LIGHTS];" // diffuse light properties
+	"\nuniform sampler2DArray uTexture;"	// every texture of the scene, one layer each
 
 	"\nvoid main()"
 	"\n{"
+		// per object material and fill light
+		"\nObjectData object = objects[vertexObjectIndex];"
+		"\nfloat ambientStrength = object.material.x;"			// ambient strength
+		"\nfloat specularIntensity = object.material.y;"		// specular strength
+		"\nfloat highlightSize = object.material.z;"			// specular size (pow)
+		"\nDiffLight fillLight = DiffLight(object.fillLightPosition.xyz, object.fillLightColor.rgb, object.fillLightPosition.w);"
+
 		// normalize normal
 		"\nvec3 normal = normalize(vertexNormal);"
 
 		// object color 
-		"\nvec3 textureColor = texture(uTexture, vertexTextureCoordinate).xyz;"			// texture color is object color
+		"\nvec3 textureColor = texture(uTexture, vec3(vertexTextureCoordinate, object.material.w)).xyz;"	// texture color is object color
 
 		// ambient lighting 
 		"\nvec3 ambient = ambientStrength * textureColor;"								// adjust color for ambient lighting
 
 		// diffuse lighting
-		"\nvec3 lightDir = normalize(diffLights[0].position - vertexFragmentPos);"
-		"\nvec3 diffuse = max(dot(normal, lightDir), 0.0f) * diffLights[0].intensity * diffLights[0].color;"		// compute amount of diffuse light from lightsource 1
+		"\nvec3 lightDir = normalize(keyLight.position - vertexFragmentPos);"
+		"\nvec3 diffuse = max(dot(normal, lightDir), 0.0f) * keyLight.intensity * keyLight.color;"		// compute amount of diffuse light from lightsource 1
 
 		// diffuse light 2 
-		"\nvec3 lightDir2 = normalize(diffLights[1].position - vertexFragmentPos);"
-		"\nvec3 diffuse2 = max(dot(normal, lightDir2), 0.0f) * diffLights[1].intensity * diffLights[1].color;"	// compute amount of diffuse light from lightsource 2
+		"\nvec3 lightDir2 = normalize(fillLight.position - vertexFragmentPos);"
+		"\nvec3 diffuse2 = max(dot(normal, lightDir2), 0.0f) * fillLight.intensity * fillLight.color;"	// compute amount of diffuse light from lightsource 2
 
 		// specular lighting 1
 		"\nvec3 viewDir = normalize(viewPosition - vertexFragmentPos);"
 		"\nvec3 reflectDir = reflect(-lightDir, normal);"
 		"\nfloat spec = pow(max(dot(viewDir, reflectDir), 0.0f), highlightSize);"
-		"\nvec3 specular = specularIntensity * spec * diffLights[0].color;"				// compute amount of specular light from light source 1
+		"\nvec3 specular = specularIntensity * spec * keyLight.color;"				// compute amount of specular light from light source 1
 
 		// specular lighting 2
 		"\nvec3 specular2 = vec3(0.0f);"
-		"\nif (diffLights[1].intensity > 0.0f) {" // only compute if light has a value
+		"\nif (fillLight.intensity > 0.0f) {" // only compute if light has a value
 		"\n  vec3 reflectDir2 = reflect(-lightDir2, normal);"
 		"\n  float spec2 = pow(max(dot(viewDir, reflectDir2), 0.0f), highlightSize);"
-		"\n  specular2 = specularIntensity * spec2 * diffLights[1].color;"			// compute amount of specular light from lightsource 2
+		"\n  specular2 = specularIntensity * spec2 * fillLight.color;"			// compute amount of specular light from lightsource 2
+		"\n}"
+
+		// find the cluster of this fragment from its screen tile and view depth
+		"\nfloat viewDepth = max(-(view * vec4(vertexFragmentPos, 1.0f)).z, 0.0001f);"
+		"\nuint slice = uint(max(log(viewDepth) * clusterDepth.x + clusterDepth.y, 0.0f));"
+		"\nuvec3 cluster = min(uvec3(uvec2(gl_FragCoord.xy / clusterDepth.zw), slice), clusterGrid.xyz - 1u);"
+		"\nuvec2 clusterLights = clusters[cluster.x + clusterGrid.x * (cluster.y + clusterGrid.y * cluster.z)];"
+
+		// point lights, diffuse and specular fading to zero at the light radius
+		"\nvec3 pointLighting = vec3(0.0f);"
+		"\nfor (uint i = 0u; i < clusterLights.y; i++) {"
+		"\n  PointLight light = pointLights[lightIndices[clusterLights.x + i]];"
+		"\n  vec3 toLight = light.positionRadius.xyz - vertexFragmentPos;"
+		"\n  float distance = length(toLight);"
+		"\n  float falloff = clamp(1.0f - distance / light.positionRadius.w, 0.0f, 1.0f);"
+		"\n  vec3 pointDir = toLight / max(distance, 0.0001f);"
+		"\n  float pointSpec = pow(max(dot(viewDir, reflect(-pointDir, normal)), 0.0f), highlightSize);"
+		"\n  pointLighting += (max(dot(normal, pointDir), 0.0f) + specularIntensity * pointSpec) * falloff * falloff * light.colorIntensity.w * light.colorIntensity.rgb;"
 		"\n}"
 
 		// output final color
-		"\nfragmentColor = vec4((ambient + diffuse + diffuse2 + specular + specular2) * textureColor, 1.0f);"
+		"\nfragmentColor = vec4((ambient + diffuse + diffuse2 + specular + specular2 + pointLighting) * textureColor, 1.0f);"
+	"\n}";
+
+// surface of the torus or cylinder at a point of its parameter domain, shared by the control and evaluation stages
+// so patch edges are measured on the same surface that is drawn, and placed as the CPU generators place it
+#define PARAMETRIC_SURFACE_SOURCE \
+	"\nuniform vec2 surfaceSize;"			/* torus ring and tube radius, or cylinder radius and height */ \
+\
+	"\nstruct SurfacePoint {" \
+		"\nvec3 position;" \
+		"\nvec3 normal;" \
+		"\nvec2 textureCoordinate;" \
+	"\n};" \
+\
+	/* u runs around the shape and v across the region, 0 torus, 1 bottom cover, 2 cylinder side, 3 top cover */ \
+	"\nSurfacePoint evaluateSurface(vec2 coordinate, int region)" \
+	"\n{" \
+		"\nSurfacePoint point;" \
+		"\nfloat angle = fract(coordinate.x) * 6.28318531f;"		/* fract puts u = 1 exactly on u = 0 so the seam does not crack */ \
+		"\nvec2 around = vec2(cos(angle), sin(angle));" \
+		"\npoint.textureCoordinate = coordinate;" \
+		"\nif (region == 0) {" \
+		"\n  float tubeAngle = fract(coordinate.y) * 6.28318531f;" \
+		"\n  point.position = vec3((surfaceSize.x + surfaceSize.y * cos(tubeAngle)) * around, surfaceSize.y * sin(tubeAngle));" \
+		"\n  point.normal = vec3(cos(tubeAngle) * around, sin(tubeAngle));" \
+		"\n}" \
+		"\nelse if (region == 2) {" \
+		"\n  point.position = vec3(surfaceSize.x * around, mix(0.5f, -0.5f, coordinate.y) * surfaceSize.y);" \
+		"\n  point.normal = vec3(around.x, 0.0f, around.y);"			/* the normal UCreateCylinderSides gives the side */ \
+		"\n}" \
+		"\nelse {" \
+		"\n  float side = region == 1 ? 0.5f : -0.5f;"					/* bottom cover at +z, top cover at -z */ \
+		"\n  point.position = vec3(surfaceSize.x * coordinate.y * around, side * surfaceSize.y);" \
+		"\n  point.normal = vec3(0.0f, 2.0f * side, 0.0f);" \
+		"\n  point.textureCoordinate = mix(vec2(0.5f), vec2(coordinate.x, 0.5f - side), coordinate.y);"	/* center to rim */ \
+		"\n}" \
+		"\nreturn point;" \
+	"\n}"
+
+const GLchar* Shader::TessellatedLightingVertexShaderSource =
+	"#version 440 core"
+	"\nlayout(location = 0) in vec3 patchCoordinate;"		// u, v and region of a patch corner
+	"\nlayout(location = 4) in uint objectIndex;"			// the instance attributes of the lighting vertex shader
+	"\nlayout(location = 5) in mat4 modelViewProjection;"
+	"\nlayout(location = 9) in mat4 model;"
+	"\nlayout(location = 13) in mat3 normalMatrix;"
+
+	"\nout vec3 controlCoordinate;"
+	"\nout uint controlObjectIndex;"
+	"\nout mat4 controlModelViewProjection;"
+	"\nout mat4 controlModel;"
+	"\nout mat3 controlNormalMatrix;"
+
+	"\nvoid main()"
+	"\n{"
+	"\n		controlCoordinate = patchCoordinate;"			// the surface is placed by the evaluation shader
+	"\n		controlObjectIndex = objectIndex;"
+	"\n		controlModelViewProjection = modelViewProjection;"
+	"\n		controlModel = model;"
+	"\n		controlNormalMatrix = normalMatrix;"
+	"\n}";
+
+const GLchar* Shader::TessellatedLightingControlShaderSource =
+	"#version 440 core"
+	"\nlayout(vertices = 4) out;"
+
+	"\nin vec3 controlCoordinate[];"
+	"\nin uint controlObjectIndex[];"
+	"\nin mat4 controlModelViewProjection[];"
+	"\nin mat4 controlModel[];"
+	"\nin mat3 controlNormalMatrix[];"
+
+	"\nout vec3 evaluationCoordinate[];"
+	"\npatch out int patchRegion;"
+	"\npatch out uint patchObjectIndex;"
+	"\npatch out mat4 patchModelViewProjection;"
+	"\npatch out mat4 patchModel;"
+	"\npatch out mat3 patchNormalMatrix;"
+
+	"\nuniform vec2 viewportSize;"			// in pixels
+	"\nuniform float targetEdgePixels;"		// length on screen of the edges the patch is split into
+
+	PARAMETRIC_SURFACE_SOURCE
+
+	"\nvec2 screenPosition(vec2 coordinate)"
+	"\n{"
+	"\n		vec4 clip = controlModelViewProjection[0] * vec4(evaluateSurface(coordinate, int(controlCoordinate[0].z)).position, 1.0f);"
+	"\n		return clip.xy / max(clip.w, 0.0001f) * 0.5f * viewportSize;"
+	"\n}"
+
+	// pieces a patch edge is split into, measured through its midpoint so the bulge of a curved edge counts
+	// the neighbouring patch measures the same three points and so splits the shared edge the same way
+	"\nfloat edgeLevel(vec2 from, vec2 to)"
+	"\n{"
+	"\n		vec2 middle = screenPosition(0.5f * (from + to));"
+	"\n		float pixels = distance(screenPosition(from), middle) + distance(middle, screenPosition(to));"
+	"\n		return clamp(pixels / targetEdgePixels, 1.0f, 64.0f);"
+	"\n}"
+
+	"\nvoid main()"
+	"\n{"
+	"\n		evaluationCoordinate[gl_InvocationID] = controlCoordinate[gl_InvocationID];"
+
+	"\n		if (gl_InvocationID == 0) {"
+	"\n		  patchRegion = int(controlCoordinate[0].z);"
+	"\n		  patchObjectIndex = controlObjectIndex[0];"
+	"\n		  patchModelViewProjection = controlModelViewProjection[0];"
+	"\n		  patchModel = controlModel[0];"
+	"\n		  patchNormalMatrix = controlNormalMatrix[0];"
+
+	// corners run (u0, v0) (u1, v0) (u1, v1) (u0, v1), outer levels are the edges at u0, v0, u1 and v1
+	"\n		  vec2 corner[4] = vec2[4](controlCoordinate[0].xy, controlCoordinate[1].xy, controlCoordinate[2].xy, controlCoordinate[3].xy);"
+	"\n		  gl_TessLevelOuter[0] = edgeLevel(corner[0], corner[3]);"
+	"\n		  gl_TessLevelOuter[1] = edgeLevel(corner[0], corner[1]);"
+	"\n		  gl_TessLevelOuter[2] = edgeLevel(corner[1], corner[2]);"
+	"\n		  gl_TessLevelOuter[3] = edgeLevel(corner[3], corner[2]);"
+	"\n		  gl_TessLevelInner[0] = max(gl_TessLevelOuter[1], gl_TessLevelOuter[3]);"
+	"\n		  gl_TessLevelInner[1] = max(gl_TessLevelOuter[0], gl_TessLevelOuter[2]);"
+	"\n		}"
+	"\n}";
+
+const GLchar* Shader::TessellatedLightingEvaluationShaderSource =
+	"#version 440 core"
+	"\nlayout(quads, fractional_odd_spacing, ccw) in;"
+
+	"\nin vec3 evaluationCoordinate[];"
+	"\npatch in int patchRegion;"
+	"\npatch in uint patchObjectIndex;"
+	"\npatch in mat4 patchModelViewProjection;"
+	"\npatch in mat4 patchModel;"
+	"\npatch in mat3 patchNormalMatrix;"
+
+	"\nout vec3 vertexNormal;"				// the inputs of the lighting fragment shader
+	"\nout vec3 vertexFragmentPos;"
+	"\nout vec2 vertexTextureCoordinate;"
+	"\nflat out uint vertexObjectIndex;"
+
+	PARAMETRIC_SURFACE_SOURCE
+
+	"\nvoid main()"
+	"\n{"
+	// patches are rectangles of the parameter domain, opposite corners are enough
+	"\n		vec2 coordinate = mix(evaluationCoordinate[0].xy, evaluationCoordinate[2].xy, gl_TessCoord.xy);"
+	"\n		SurfacePoint point = evaluateSurface(coordinate, patchRegion);"
+
+	"\n		vertexFragmentPos = vec3(patchModel * vec4(point.position, 1.0f));"
+	"\n		gl_Position = patchModelViewProjection * vec4(point.position, 1.0f);"
+	"\n		vertexNormal = patchNormalMatrix * point.normal;"
+	"\n		vertexTextureCoordinate = point.textureCoordinate;"
+	"\n		vertexObjectIndex = patchObjectIndex;"
+	"\n}";
+
+// one triangle covering the layer, its texture coordinates run 0 to 1 across the visible part
+const GLchar* Shader::TextureLayerVertexShaderSource =
+	"#version 440 core"
+	"\nout vec2 vertexTextureCoordinate;"
+
+	"\nvoid main()"
+	"\n{"
+	"\n		vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);"		// (0, 0) (2, 0) (0, 2)
+	"\n		vertexTextureCoordinate = corner;"
+	"\n		gl_Position = vec4(corner * 2.0f - 1.0f, 0.0f, 1.0f);"
+	"\n}";
+
+const GLchar* Shader::TextureLayerFragmentShaderSource =
+	"#version 440 core"
+	"\nin vec2 vertexTextureCoordinate;"
+
+	"\nout vec4 fragmentColor;"
+
+	"\nuniform sampler2D uTexture;"			// the source texture, any size
+
+	// the derivatives across the layer pick the source's mip level, a larger source is filtered down by its own chain
+	"\nvoid main()"
+	"\n{"
+	"\n		fragmentColor = texture(uTexture, vertexTextureCoordinate);"
 	"\n}";
 
 Shader::Shader() {
@@ -180,6 +439,20 @@ Shader::Shader(const char* vertexShaderSource, const char* fragmentShaderSource)
 	CompileProgram(vertexShaderSource, fragmentShaderSource);
 }
 
+Shader::Shader(const char* vertexShaderSource, const char* fragmentShaderSource, CompileMode mode) {
+	if (mode == CompileMode::Deferred)
+		BeginCompile(vertexShaderSource, fragmentShaderSource);
+	else
+		CompileProgram(vertexShaderSource, fragmentShaderSource);
+}
+
+Shader::Shader(const char* vertexShaderSource, const char* tessControlShaderSource, const char* tessEvaluationShaderSource,
+	const char* fragmentShaderSource, CompileMode mode) {
+	BeginCompile(vertexShaderSource, fragmentShaderSource, tessControlShaderSource, tessEvaluationShaderSource);
+	if (mode == CompileMode::Immediate)
+		finishCompile();
+}
+
 Shader::Shader(std::string vertexPath, std::string fragmentPath) {
 	std::string vertexCode;
 	std::string fragmentCode;
@@ -215,102 +488,224 @@ Shader::Shader(std::string vertexPath, std::string fragmentPath) {
 }
 
 void Shader::use() {
+	finishCompile();
+
 	if (ID != 0)
-		glUseProgram(ID);
+		GLStateCache::get().useProgram(ID);
+}
+
+// poll a deferred compile, with GL_KHR_parallel_shader_compile the completion query does not wait for the driver
+bool Shader::isReady() {
+	if (!compilePending)
+		return true;
+
+	if (GLEW_KHR_parallel_shader_compile) {
+		GLint completed = GL_FALSE;
+		glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+		if (!completed)
+			return false;
+	}
+
+	finishCompile();
+	return true;
 }
 
 void Shader::setProjectionMatrix(const glm::mat4& projection) {
-	GLint location = glGetUniformLocation(ID, "projection");
-	if (location != -1)
-		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(projection));
+	UniformAt<glm::mat4>(getUniformLocation("projection")).set(projection);
 }
 
 void Shader::setModelMatrix(const glm::mat4& model) {
-	GLint location = glGetUniformLocation(ID, "model");
-	if (location != -1)
-		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(model));
+	UniformAt<glm::mat4>(getUniformLocation("model")).set(model);
 }
 
 void Shader::setViewMatrix(const glm::mat4& view) {
-	GLint location = glGetUniformLocation(ID, "view");
-	if (location != -1)	
-		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(view));
+	UniformAt<glm::mat4>(getUniformLocation("view")).set(view);
 }
 
 // tell shader which texture unit to use
 void Shader::setTextureUnit(GLint unit) {
-	GLint location = glGetUniformLocation(ID, "uTexture");
-	if (location != -1)	
-		glUniform1i(location, 0);  
+	UniformAt<GLint>(getUniformLocation("uTexture")).set(unit);
+}
+
+void Shader::setUniformValue(const GLchar* name, GLfloat value) {
+	UniformAt<GLfloat>(getUniformLocation(name)).set(value);
+}
+
+void Shader::setUniformValue(const GLchar* name, glm::vec3 value) {
+	UniformAt<glm::vec3>(getUniformLocation(name)).set(value);
 }
 
-void Shader::setUniformValue(std::string name, GLfloat value) {
-	GLint location = glGetUniformLocation(ID, name.c_str());
-	if (location != -1)
-		glUniform1f(location, value);
+bool UniformShadow::update(const void* newValue, size_t size) {
+	if (known && memcmp(value, newValue, size) == 0) {
+		GLStateCache::get().countUniform(false);
+		return false;
+	}
+
+	memcpy(value, newValue, size);
+	known = true;
+	GLStateCache::get().countUniform(true);
+	return true;
 }
 
-void Shader::setUniformValue(std::string name, glm::vec3 value) {
-	GLint location = glGetUniformLocation(ID, name.c_str());
-	if (location != -1)
-		glUniform3f(location, value.x, value.y, value.z);
+// look up a uniform location in the table built at link time, no driver round trip
+GLint Shader::getUniformLocation(const GLchar* name) const {
+	const UniformEntry* entry = findUniform(name);
+	return entry != nullptr ? entry->location : -1;
+}
+
+const Shader::UniformEntry* Shader::findUniform(const GLchar* name) const {
+	auto entry = std::lower_bound(uniforms.begin(), uniforms.end(), name,
+		[](const UniformEntry& lhs, const GLchar* rhs) { return lhs.name.compare(rhs) < 0; });
+
+	if (entry != uniforms.end() && entry->name.compare(name) == 0)
+		return &*entry;
+
+	return nullptr;
 }
 
 Shader::~Shader() {
+	if (compilePending)
+		DeleteStages();
+
 	if (ID != 0)
-		glDeleteProgram(ID);
+		GLStateCache::get().deleteProgram(ID);
 }
 
 void Shader::CompileProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
-	// Compilation and linkage error reporting
-	int success = 0;
-	char infoLog[512];
+	BeginCompile(vertexShaderSource, fragmentShaderSource);
+	finishCompile();
+}
 
+// hand the sources to the driver and start linking without querying any status, finishCompile collects the result
+void Shader::BeginCompile(const char* vertexShaderSource, const char* fragmentShaderSource,
+	const char* tessControlShaderSource, const char* tessEvaluationShaderSource) {
 	// Create a Shader program object.
 	ID = glCreateProgram();
 
-	// Create the vertex and fragment shader objects
-	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	GLuint fragShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-
-	// Retrive the shader source
-	glShaderSource(vertexShaderId, 1, &vertexShaderSource, NULL);
-	glShaderSource(fragShaderId, 1, &fragmentShaderSource, NULL);
-
-	// Compile the vertex shader, and print compilation errors (if any)
-	glCompileShader(vertexShaderId); // compile the vertex shader
-	// check for shader compile errors
-	glGetShaderiv(vertexShaderId, GL_COMPILE_STATUS, &success);
-	if (!success)
+	// a binary linked by an earlier run skips compiling and linking entirely, the driver may still reject it so the
+	// sources are kept until finishCompile has seen its status
+	binaryCachePath = ProgramBinaryCachePath(vertexShaderSource, fragmentShaderSource, tessControlShaderSource, tessEvaluationShaderSource);
+	if (!binaryCachePath.empty() && LoadProgramBinary(binaryCachePath))
 	{
-		glGetShaderInfoLog(vertexShaderId, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-
+		binarySources[0] = vertexShaderSource;
+		binarySources[1] = fragmentShaderSource;
+		binarySources[2] = tessControlShaderSource != nullptr ? tessControlShaderSource : "";
+		binarySources[3] = tessEvaluationShaderSource != nullptr ? tessEvaluationShaderSource : "";
+		binaryPending = true;
+		compilePending = true;
 		return;
 	}
 
-	glCompileShader(fragShaderId); // compile the fragment shader
-	// check for shader compile errors
-	glGetShaderiv(fragShaderId, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(fragShaderId, sizeof(infoLog), NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+	LinkStages(vertexShaderSource, fragmentShaderSource, tessControlShaderSource, tessEvaluationShaderSource);
+}
 
-		return;
-	}
+// compile every stage, attach it to the shader program and start linking without querying any status
+void Shader::LinkStages(const char* vertexShaderSource, const char* fragmentShaderSource,
+	const char* tessControlShaderSource, const char* tessEvaluationShaderSource) {
+	// compile every stage and attach it to the shader program
+	vertexShaderId = AttachStage(GL_VERTEX_SHADER, vertexShaderSource);
+	tessControlShaderId = AttachStage(GL_TESS_CONTROL_SHADER, tessControlShaderSource);
+	tessEvaluationShaderId = AttachStage(GL_TESS_EVALUATION_SHADER, tessEvaluationShaderSource);
+	fragShaderId = AttachStage(GL_FRAGMENT_SHADER, fragmentShaderSource);
 
-	// Attached compiled shaders to the shader program
-	glAttachShader(ID, vertexShaderId);
-	glAttachShader(ID, fragShaderId);
+	// ask the driver to keep the linked binary so it can be written to the cache
+	if (!binaryCachePath.empty())
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
 	glLinkProgram(ID);   // links the shader program
-	// check for linking errors
+
+	compilePending = true;
+}
+
+// compile one stage into the program, a null source leaves the stage out and returns 0
+GLuint Shader::AttachStage(GLenum stage, const char* source) {
+	if (source == nullptr)
+		return 0;
+
+	GLuint shaderId = glCreateShader(stage);
+	glShaderSource(shaderId, 1, &source, NULL);
+	glCompileShader(shaderId);
+	glAttachShader(ID, shaderId);
+
+	return shaderId;
+}
+
+// print the compile log of a stage that failed, true if it did
+bool Shader::ReportCompileError(GLuint shaderId, const char* stageName) {
+	if (shaderId == 0)
+		return false;
+
+	int success = 0;
+	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
+	if (success)
+		return false;
+
+	char infoLog[512];
+	glGetShaderInfoLog(shaderId, sizeof(infoLog), NULL, infoLog);
+	std::cout << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+	return true;
+}
+
+// glDeleteShader ignores 0, so stages the program does not have need no check
+void Shader::DeleteStages() {
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(tessControlShaderId);
+	glDeleteShader(tessEvaluationShaderId);
+	glDeleteShader(fragShaderId);
+}
+
+void Shader::finishCompile() {
+	if (!compilePending)
+		return;
+
+	compilePending = false;
+
+	// Compilation and linkage error reporting
+	int success = 0;
+
+	// a cached binary is checked here rather than when it was handed over, so the check never blocks a prefetch
+	if (binaryPending) {
+		binaryPending = false;
+
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		fromBinaryCache = success != 0;
+
+		// a binary the driver rejects, after a driver update for instance, is compiled from the sources instead and
+		// this call waits for that link below
+		if (!fromBinaryCache) {
+			LinkStages(binarySources[0].c_str(), binarySources[1].c_str(),
+				binarySources[2].empty() ? nullptr : binarySources[2].c_str(), binarySources[3].empty() ? nullptr : binarySources[3].c_str());
+			compilePending = false;
+		}
+
+		for (std::string& source : binarySources)
+			std::string().swap(source);
+
+		if (fromBinaryCache) {
+			CacheUniformLocations();
+			return;
+		}
+	}
+
+	// check for linking errors, the first status query waits for the driver
 	glGetProgramiv(ID, GL_LINK_STATUS, &success);
 	if (!success)
 	{
-		glGetProgramInfoLog(ID, sizeof(infoLog), NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		// report the stage that failed to compile, otherwise the link itself failed
+		if (!ReportCompileError(vertexShaderId, "VERTEX") &&
+			!ReportCompileError(tessControlShaderId, "TESS_CONTROL") &&
+			!ReportCompileError(tessEvaluationShaderId, "TESS_EVALUATION") &&
+			!ReportCompileError(fragShaderId, "FRAGMENT"))
+		{
+			char infoLog[512];
+			glGetProgramInfoLog(ID, sizeof(infoLog), NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+
+		// a program id of 0 tells the caller the program is unusable
+		DeleteStages();
+		GLStateCache::get().deleteProgram(ID);
+		ID = 0;
 
 		return;
 	}
@@ -318,8 +713,157 @@ void Shader::CompileProgram(const char* vertexShaderSource, const char* fragment
 //	glUseProgram(ID);    // Uses the shader program
 
 	// clean up source files
-	glDeleteShader(vertexShaderId);
-	glDeleteShader(fragShaderId);
+	GLuint stageIds[] = { vertexShaderId, tessControlShaderId, tessEvaluationShaderId, fragShaderId };
+	for (GLuint shaderId : stageIds)
+		if (shaderId != 0)
+			glDetachShader(ID, shaderId);
+	DeleteStages();
+
+	if (!binaryCachePath.empty())
+		SaveProgramBinary(binaryCachePath);
+
+	// resolve every active uniform once so the setters never query the driver
+	CacheUniformLocations();
 
 	return;
+}
+
+// cache file name from a hash of both sources and the driver identity, a driver update gives a new name
+// returns an empty path when the driver offers no program binary formats
+std::string Shader::ProgramBinaryCachePath(const char* vertexShaderSource, const char* fragmentShaderSource,
+	const char* tessControlShaderSource, const char* tessEvaluationShaderSource) {
+	GLint binaryFormatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+	if (binaryFormatCount == 0)
+		return std::string();
+
+	const char* keyParts[] = {
+		vertexShaderSource,
+		fragmentShaderSource,
+		tessControlShaderSource,		// null for programs without tessellation, so their key is unchanged
+		tessEvaluationShaderSource,
+		(const char*)glGetString(GL_VENDOR),
+		(const char*)glGetString(GL_RENDERER),
+		(const char*)glGetString(GL_VERSION)
+	};
+
+	// 64 bit FNV-1a, parts are separated by their terminating zero
+	unsigned long long hash = 14695981039346656037ULL;
+	for (const char* part : keyParts) {
+		if (part == nullptr)
+			continue;
+
+		for (const char* c = part; ; c++) {
+			hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+			if (*c == '\0')
+				break;
+		}
+	}
+
+	std::stringstream path;
+	path << ProgramBinaryCacheDirectory << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+
+	return path.str();
+}
+
+// hand a cached program binary to the driver, false on a miss, whether the driver accepts it is left to finishCompile
+bool Shader::LoadProgramBinary(const std::string& path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::streamoff fileSize = file.tellg();
+	if (fileSize <= (std::streamoff)sizeof(GLenum))
+		return false;
+
+	GLenum binaryFormat = 0;
+	std::vector<char> binary((size_t)fileSize - sizeof(binaryFormat));
+
+	file.seekg(0);
+	file.read((char*)&binaryFormat, sizeof(binaryFormat));
+	file.read(binary.data(), binary.size());
+	if (!file)
+		return false;
+
+	glProgramBinary(ID, binaryFormat, binary.data(), (GLsizei)binary.size());
+	return true;
+}
+
+// write the linked program to the cache, failures only cost the next startup a compile
+void Shader::SaveProgramBinary(const std::string& path) {
+	GLint binaryLength = 0;
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+		return;
+
+	std::vector<char> binary(binaryLength);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(ID, binaryLength, NULL, &binaryFormat, binary.data());
+
+#ifdef _WIN32
+	_mkdir(ProgramBinaryCacheDirectory);
+#else
+	mkdir(ProgramBinaryCacheDirectory, 0755);
+#endif
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return;
+
+	file.write((const char*)&binaryFormat, sizeof(binaryFormat));
+	file.write(binary.data(), binary.size());
+}
+
+// list the active uniforms of the linked program into a flat table sorted by name
+void Shader::CacheUniformLocations() {
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<GLchar> nameBuffer(maxNameLength + 1);
+
+	uniforms.clear();
+	uniforms.reserve(uniformCount);
+
+	for (GLint i = 0; i < uniformCount; i++) {
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = 0;
+
+		glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data());
+
+		std::string name(nameBuffer.data(), nameLength);
+		GLint location = glGetUniformLocation(ID, name.c_str());
+
+		if (location == -1)		// members of uniform blocks have no location
+			continue;
+
+		uniforms.push_back({ name, location, type });
+
+		// arrays of basic types are reported once as "name[0]", add the bare name and the remaining elements
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+			std::string baseName = name.substr(0, name.size() - 3);
+			uniforms.push_back({ baseName, location, type });
+
+			for (GLint element = 1; element < size; element++) {
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				GLint elementLocation = glGetUniformLocation(ID, elementName.c_str());
+
+				if (elementLocation != -1)
+					uniforms.push_back({ elementName, elementLocation, type });
+			}
+		}
+	}
+
+	std::sort(uniforms.begin(), uniforms.end(),
+		[](const UniformEntry& lhs, const UniformEntry& rhs) { return lhs.name < rhs.name; });
+
+	// linking resets every uniform, so no previously uploaded value is known
+	GLint maxLocation = -1;
+	for (const UniformEntry& entry : uniforms)
+		maxLocation = std::max(maxLocation, entry.location);
+
+	uniformShadows.assign(maxLocation + 1, UniformShadow());
 }
\ No newline at end of file
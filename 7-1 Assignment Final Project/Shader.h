@@ -6,10 +6,97 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+// maps a uniform value type to its GL type and upload call, only the specialized types are supported
+// uploads name their program, so a value reaches it whichever program is in use
+template <typename T>
+struct UniformTraits {
+    static const bool supported = false;
+};
+
+template <>
+struct UniformTraits<GLint> {
+    static const bool supported = true;
+    static bool accepts(GLenum type) { return type == GL_INT || type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY; }
+    static void upload(GLuint program, GLint location, const GLint& value) { glProgramUniform1i(program, location, value); }
+};
+
+template <>
+struct UniformTraits<GLfloat> {
+    static const bool supported = true;
+    static bool accepts(GLenum type) { return type == GL_FLOAT; }
+    static void upload(GLuint program, GLint location, const GLfloat& value) { glProgramUniform1f(program, location, value); }
+};
+
+template <>
+struct UniformTraits<glm::vec2> {
+    static const bool supported = true;
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC2; }
+    static void upload(GLuint program, GLint location, const glm::vec2& value) { glProgramUniform2fv(program, location, 1, glm::value_ptr(value)); }
+};
+
+template <>
+struct UniformTraits<glm::vec3> {
+    static const bool supported = true;
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC3; }
+    static void upload(GLuint program, GLint location, const glm::vec3& value) { glProgramUniform3fv(program, location, 1, glm::value_ptr(value)); }
+};
+
+template <>
+struct UniformTraits<glm::mat3> {
+    static const bool supported = true;
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT3; }
+    static void upload(GLuint program, GLint location, const glm::mat3& value) { glProgramUniformMatrix3fv(program, location, 1, GL_FALSE, glm::value_ptr(value)); }
+};
+
+template <>
+struct UniformTraits<glm::mat4> {
+    static const bool supported = true;
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT4; }
+    static void upload(GLuint program, GLint location, const glm::mat4& value) { glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, glm::value_ptr(value)); }
+};
+
+// last value uploaded to one uniform location, uploads of an identical value are skipped
+struct UniformShadow {
+    bool known = false;                         // nothing uploaded since the program was linked
+    unsigned char value[sizeof(glm::mat4)];     // large enough for every supported type
+
+    // copies value in and returns true if it differs from the last upload
+    bool update(const void* newValue, size_t size);
+};
+
+class Shader;
+
+// typed handle to a uniform of a Shader, resolved once and set without any lookup or allocation
+template <typename T>
+class Uniform {
+    static_assert(UniformTraits<T>::supported, "Uniform<T> supports GLint, GLfloat, glm::vec2, glm::vec3, glm::mat3 and glm::mat4");
+
+public:
+    Uniform() {}
+
+    // behavior, sets the value on the handle's program whether or not it is in use, nothing is sent if it is unchanged
+    void set(const T& value) const;
+
+    // accessors
+    bool isValid() const { return location != -1; }
+    GLint getLocation() const { return location; }
+
+private:
+    friend class Shader;
+
+    Uniform(const Shader* owner, GLuint program, GLint location) : owner(owner), program(program), location(location) {}
+
+    const Shader* owner = nullptr;      // holds the shadow of the location, looked up on every set as a relink replaces it
+    GLuint program = 0;
+    GLint location = -1;
+};
+
 class Shader {
 
 public:
@@ -21,30 +108,141 @@ public:
     static const GLchar* LampFragmentShaderSource;
     static const GLchar* LightingVertexShaderSource;
     static const GLchar* LightingFragmentShaderSource;
+    static const GLchar* TessellatedLightingVertexShaderSource;       // lit with LightingFragmentShaderSource
+    static const GLchar* TessellatedLightingControlShaderSource;
+    static const GLchar* TessellatedLightingEvaluationShaderSource;
+    static const GLchar* TextureLayerVertexShaderSource;              // fills a layer of a texture array from a 2D texture
+    static const GLchar* TextureLayerFragmentShaderSource;
+
+    static const char* ProgramBinaryCacheDirectory;   // linked program binaries are kept here between runs
+
+    // Immediate checks the link status in the constructor, Deferred leaves the driver compiling until first use
+    enum class CompileMode { Immediate, Deferred };
 
     // constructor reads and builds the shader
     Shader();
     Shader(const char* vertexShaderSource, const char* fragmentShaderSource);
+    Shader(const char* vertexShaderSource, const char* fragmentShaderSource, CompileMode mode);
+    // tessellation control and evaluation stages between the vertex and fragment stages, either may be null
+    Shader(const char* vertexShaderSource, const char* tessControlShaderSource, const char* tessEvaluationShaderSource,
+           const char* fragmentShaderSource, CompileMode mode);
     Shader(std::string vertexPath, std::string fragmentPath);
 
     ~Shader();
 
+    // uniform handles point back at their program
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
     // behavior
     void use();
+    bool isReady();         // never blocks when the driver supports parallel compile
+    void finishCompile();   // waits for a deferred compile and checks its link status
 
     // accessors
     GLuint getProgramId() { return ID; }
+    bool isFromBinaryCache() const { return fromBinaryCache; }
+    GLint getUniformLocation(const GLchar* name) const;
+
+    // resolve a typed uniform handle, a name that is inactive or of another type gives an invalid handle
+    template <typename T>
+    Uniform<T> uniform(const GLchar* name) const;
+    // resolve a member of an array of structs, e.g. uniform<glm::vec3>("diffLights", 0, "position")
+    template <typename T>
+    Uniform<T> uniform(const GLchar* arrayName, GLuint index, const GLchar* memberName) const;
 
     // mutators
     void setProjectionMatrix(const glm::mat4& projection);
     void setModelMatrix(const glm::mat4& model);
     void setViewMatrix(const glm::mat4& view);
     void setTextureUnit(GLint unit);
-    void setUniformValue(std::string name, GLfloat value);
-    void setUniformValue(std::string name, glm::vec3 value);
+    void setUniformValue(const GLchar* name, GLfloat value);
+    void setUniformValue(const GLchar* name, glm::vec3 value);
 
 private:
+    template <typename T>
+    friend class Uniform;
+
+    // active uniform name and location, filled once after linking
+    struct UniformEntry {
+        std::string name;
+        GLint location;
+        GLenum type;
+    };
+
     GLuint ID = 0;
+    bool fromBinaryCache = false;          // program was loaded with glProgramBinary instead of compiled
+    std::vector<UniformEntry> uniforms;    // sorted by name for binary search
+    mutable std::vector<UniformShadow> uniformShadows;    // indexed by location, reset on every link
+
+    // state of a compile that was started but whose status has not been checked
+    bool compilePending = false;
+    GLuint vertexShaderId = 0;
+    GLuint fragShaderId = 0;
+    GLuint tessControlShaderId = 0;         // 0 when the program has no tessellation stages
+    GLuint tessEvaluationShaderId = 0;
+    std::string binaryCachePath;
+    bool binaryPending = false;             // the pending program is a cached binary whose link status is unchecked
+    std::string binarySources[4];           // vertex, fragment, tess control and evaluation, compiled if the binary is rejected
 
     void CompileProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
-};
\ No newline at end of file
+    void BeginCompile(const char* vertexShaderSource, const char* fragmentShaderSource,
+                      const char* tessControlShaderSource = nullptr, const char* tessEvaluationShaderSource = nullptr);
+    void LinkStages(const char* vertexShaderSource, const char* fragmentShaderSource,
+                    const char* tessControlShaderSource, const char* tessEvaluationShaderSource);
+    GLuint AttachStage(GLenum stage, const char* source);
+    bool ReportCompileError(GLuint shaderId, const char* stageName);
+    void DeleteStages();
+    std::string ProgramBinaryCachePath(const char* vertexShaderSource, const char* fragmentShaderSource,
+                                       const char* tessControlShaderSource, const char* tessEvaluationShaderSource);
+    bool LoadProgramBinary(const std::string& path);
+    void SaveProgramBinary(const std::string& path);
+    void CacheUniformLocations();
+    const UniformEntry* findUniform(const GLchar* name) const;
+
+    template <typename T>
+    Uniform<T> UniformAt(GLint location) const;
+    UniformShadow* ShadowAt(GLint location) const;     // null for a location the current link does not have
+};
+
+template <typename T>
+void Uniform<T>::set(const T& value) const {
+    if (location == -1)
+        return;
+
+    UniformShadow* shadow = owner->ShadowAt(location);
+    if (shadow != nullptr && shadow->update(&value, sizeof(T)))
+        UniformTraits<T>::upload(program, location, value);
+}
+
+template <typename T>
+Uniform<T> Shader::uniform(const GLchar* name) const {
+    const UniformEntry* entry = findUniform(name);
+    if (entry == nullptr)
+        return Uniform<T>();
+
+    if (!UniformTraits<T>::accepts(entry->type)) {
+        std::cout << "ERROR::SHADER::UNIFORM::TYPE_MISMATCH " << name << std::endl;
+        return Uniform<T>();
+    }
+
+    return UniformAt<T>(entry->location);
+}
+
+template <typename T>
+Uniform<T> Shader::uniform(const GLchar* arrayName, GLuint index, const GLchar* memberName) const {
+    std::string name = std::string(arrayName) + "[" + std::to_string(index) + "]." + memberName;
+    return uniform<T>(name.c_str());
+}
+
+template <typename T>
+Uniform<T> Shader::UniformAt(GLint location) const {
+    if (location < 0 || location >= (GLint)uniformShadows.size())
+        return Uniform<T>();
+
+    return Uniform<T>(this, ID, location);
+}
+
+inline UniformShadow* Shader::ShadowAt(GLint location) const {
+    return location < (GLint)uniformShadows.size() ? &uniformShadows[location] : nullptr;
+}
@@ -0,0 +1,39 @@
+#include "ShaderLibrary.h"
+
+const ShaderLibrary::ProgramSources ShaderLibrary::Sources[(int)ProgramId::Count] = {
+	{ Shader::DefaultVertexShaderSource,  Shader::DefaultVertexFragmentShaderSource, nullptr, nullptr },	// Default
+	{ Shader::TextureVertexShaderSource,  Shader::TextureFragmentShaderSource, nullptr, nullptr },		// Texture
+	{ Shader::LampVertexShaderSource,     Shader::LampFragmentShaderSource, nullptr, nullptr },			// Lamp
+	{ Shader::LightingVertexShaderSource, Shader::LightingFragmentShaderSource, nullptr, nullptr },		// Lighting
+	{ Shader::TessellatedLightingVertexShaderSource, Shader::LightingFragmentShaderSource,
+	  Shader::TessellatedLightingControlShaderSource, Shader::TessellatedLightingEvaluationShaderSource },	// TessellatedLighting
+	{ Shader::TextureLayerVertexShaderSource, Shader::TextureLayerFragmentShaderSource, nullptr, nullptr },	// TextureLayer
+};
+
+ShaderLibrary::ShaderLibrary() {
+	// let the driver compile on its own threads, 0xFFFFFFFF asks for as many as it wants
+	if (GLEW_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+}
+
+ShaderLibrary::~ShaderLibrary() {
+	for (Shader* program : programs)
+		delete program;
+}
+
+void ShaderLibrary::prefetch(ProgramId id) {
+	Shader*& program = programs[(int)id];
+	if (program == nullptr) {
+		const ProgramSources& sources = Sources[(int)id];
+		program = new Shader(sources.vertex, sources.tessControl, sources.tessEvaluation, sources.fragment, Shader::CompileMode::Deferred);
+	}
+}
+
+Shader* ShaderLibrary::get(ProgramId id) {
+	prefetch(id);
+
+	Shader* program = programs[(int)id];
+	program->finishCompile();
+
+	return program;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Shader.h"
+
+// programs built from the sources embedded in Shader
+enum class ProgramId {
+    Default = 0,
+    Texture,
+    Lamp,
+    Lighting,
+    TessellatedLighting,
+    TextureLayer,
+    Count
+};
+
+// owns every program and creates each one the first time it is asked for
+class ShaderLibrary {
+
+public:
+    ShaderLibrary();
+    ~ShaderLibrary();
+
+    // behavior
+    void prefetch(ProgramId id);    // start compiling now without waiting for the driver
+    Shader* get(ProgramId id);      // create on first request, waits for the compile if still running
+
+    // accessors
+    bool isCreated(ProgramId id) const { return programs[(int)id] != nullptr; }
+
+private:
+    struct ProgramSources {
+        const GLchar* vertex;
+        const GLchar* fragment;
+        const GLchar* tessControl;      // null for programs without tessellation
+        const GLchar* tessEvaluation;
+    };
+
+    static const ProgramSources Sources[(int)ProgramId::Count];
+
+    Shader* programs[(int)ProgramId::Count] = {};
+};
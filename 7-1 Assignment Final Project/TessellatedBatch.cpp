@@ -0,0 +1,140 @@
+#include "TessellatedBatch.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+
+TessellatedBatch::TessellatedBatch(const Shader& program) {
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &patchBuffer);
+	glGenBuffers(1, &objectBuffer);
+	glGenBuffers(1, &instanceBuffer);
+
+	surfaceSizeUniform = program.uniform<glm::vec2>("surfaceSize");
+	viewportSizeUniform = program.uniform<glm::vec2>("viewportSize");
+	targetEdgePixelsUniform = program.uniform<GLfloat>("targetEdgePixels");
+
+	CreatePatches();
+}
+
+TessellatedBatch::~TessellatedBatch() {
+	GLuint buffers[] = { patchBuffer, objectBuffer, instanceBuffer };
+	GLStateCache::get().deleteBuffers(3, buffers);
+	GLStateCache::get().deleteVertexArrays(1, &vao);
+}
+
+void TessellatedBatch::add(ParametricSurface surface, const glm::vec2& size, GLuint texture, const ObjectData& object) {
+	objects.push_back({ surface, size, texture, object });
+}
+
+void TessellatedBatch::clear() {
+	objects.clear();
+	groups.clear();
+	instances.clear();
+}
+
+void TessellatedBatch::upload() {
+	// objects sharing a texture, surface and size are the instances of one draw, the size is a uniform
+	std::stable_sort(objects.begin(), objects.end(), [](const Object& a, const Object& b) {
+		if (a.Texture != b.Texture)
+			return a.Texture < b.Texture;
+		if (a.Surface != b.Surface)
+			return a.Surface < b.Surface;
+		return a.Size.x != b.Size.x ? a.Size.x < b.Size.x : a.Size.y < b.Size.y;
+	});
+
+	groups.clear();
+	std::vector<ObjectData> objectData;
+	objectData.reserve(objects.size());
+
+	for (GLuint i = 0; i < (GLuint)objects.size(); i++) {
+		const Object& object = objects[i];
+
+		if (groups.empty() || groups.back().Texture != object.Texture || groups.back().Surface != object.Surface || groups.back().Size != object.Size)
+			groups.push_back({ object.Surface, object.Size, object.Texture, i, 0 });
+		groups.back().InstanceCount++;
+
+		objectData.push_back(object.Data);
+	}
+
+	GLStateCache::get().bindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ObjectData) * objectData.size(), objectData.data(), GL_STATIC_DRAW);
+}
+
+void TessellatedBatch::update(const glm::mat4& viewProjection) {
+	instances.resize(objects.size());
+
+	for (size_t i = 0; i < objects.size(); i++) {
+		InstanceData& instance = instances[i];
+		instance.ModelViewProjection = viewProjection * objects[i].Data.Model;
+		instance.Model = objects[i].Data.Model;
+		std::copy(objects[i].Data.NormalMatrix, objects[i].Data.NormalMatrix + 3, instance.NormalMatrix);
+		instance.ObjectIndex = (GLuint)i;
+	}
+
+	// respecified each frame so the driver can hand out fresh storage instead of waiting on the last frame
+	GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * instances.size(), instances.data(), GL_STREAM_DRAW);
+}
+
+void TessellatedBatch::draw(GLuint viewportWidth, GLuint viewportHeight) {
+	GLStateCache::get().bindBufferBase(GL_SHADER_STORAGE_BUFFER, SceneBatch::ObjectBinding, objectBuffer);
+	GLStateCache::get().bindVertexArray(vao);
+	glBindVertexBuffer(VertexBinding + 1, instanceBuffer, 0, sizeof(InstanceData));
+
+	viewportSizeUniform.set(glm::vec2(viewportWidth, viewportHeight));
+	targetEdgePixelsUniform.set(TargetEdgePixels);
+
+	glPatchParameteri(GL_PATCH_VERTICES, 4);
+	GLStateCache::get().activeTexture(GL_TEXTURE0);
+
+	for (const SurfaceGroup& group : groups) {
+		int surface = (int)group.Surface;
+
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, group.Texture);
+		surfaceSizeUniform.set(group.Size);
+		glDrawArraysInstancedBaseInstance(GL_PATCHES, firstCorner[surface], cornerCount[surface], group.InstanceCount, group.FirstInstance);
+	}
+}
+
+// one vertex buffer of patch corners for every surface, a few hundred bytes in place of every baked level of detail
+void TessellatedBatch::CreatePatches() {
+	std::vector<glm::vec3> corners;
+	const GLfloat step = 1.0f / PatchSegments;
+
+	// the torus is a grid around the ring and around the tube, all region 0
+	firstCorner[(int)ParametricSurface::Torus] = (GLuint)corners.size();
+	for (GLuint i = 0; i < PatchSegments; i++)
+		for (GLuint j = 0; j < PatchSegments; j++)
+			AddPatch(corners, i * step, j * step, (i + 1) * step, (j + 1) * step, 0.0f);
+	cornerCount[(int)ParametricSurface::Torus] = (GLuint)corners.size() - firstCorner[(int)ParametricSurface::Torus];
+
+	// the cylinder is a ring of patches for the bottom cover, the side and the top cover, v runs from center to rim on the covers
+	firstCorner[(int)ParametricSurface::Cylinder] = (GLuint)corners.size();
+	for (GLuint region = 1; region <= 3; region++)
+		for (GLuint i = 0; i < PatchSegments; i++)
+			AddPatch(corners, i * step, 0.0f, (i + 1) * step, 1.0f, (GLfloat)region);
+	cornerCount[(int)ParametricSurface::Cylinder] = (GLuint)corners.size() - firstCorner[(int)ParametricSurface::Cylinder];
+
+	patchCount = (GLuint)corners.size() / 4;
+
+	GLStateCache::get().bindVertexArray(vao);
+	GLStateCache::get().bindBuffer(GL_ARRAY_BUFFER, patchBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * corners.size(), corners.data(), GL_STATIC_DRAW);
+
+	glBindVertexBuffer(VertexBinding, patchBuffer, 0, sizeof(glm::vec3));
+	glVertexAttribFormat(PatchAttribute, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexAttribBinding(PatchAttribute, VertexBinding);
+	GLStateCache::get().enableVertexAttribArray(PatchAttribute);
+
+	SceneBatch::formatInstanceAttributes(VertexBinding + 1);
+
+	GLStateCache::get().bindVertexArray(0);
+}
+
+// corners in the order the control shader expects, (u0, v0) (u1, v0) (u1, v1) (u0, v1)
+void TessellatedBatch::AddPatch(std::vector<glm::vec3>& corners, GLfloat u0, GLfloat v0, GLfloat u1, GLfloat v1, GLfloat region) {
+	corners.push_back(glm::vec3(u0, v0, region));
+	corners.push_back(glm::vec3(u1, v0, region));
+	corners.push_back(glm::vec3(u1, v1, region));
+	corners.push_back(glm::vec3(u0, v1, region));
+}
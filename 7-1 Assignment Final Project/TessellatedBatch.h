@@ -0,0 +1,86 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "SceneBatch.h"
+#include "Shader.h"
+
+// shapes the tessellation evaluation shader places on their exact surface
+enum class ParametricSurface {
+    Torus = 0,
+    Cylinder,
+    Count
+};
+
+// torus and cylinder objects drawn from a coarse grid of patches instead of baked meshes, the control shader splits
+// each patch edge by its length on screen and the evaluation shader moves the new vertices onto the surface
+class TessellatedBatch {
+
+public:
+    static const GLuint PatchAttribute = 0;        // u, v and surface region of a patch corner
+    static const GLuint PatchSegments = 8;          // patches around each shape and across the torus tube
+    static const GLuint VertexBinding = 0;
+
+    // the program must be built from the tessellated lighting sources, the batch sets its surface uniforms
+    TessellatedBatch(const Shader& program);
+    ~TessellatedBatch();
+
+    // behavior
+    // size is the torus ring and tube radius, or the cylinder radius and height
+    void add(ParametricSurface surface, const glm::vec2& size, GLuint texture, const ObjectData& object);
+    void clear();
+    // groups the objects by texture, surface and size and uploads the object data and instances
+    void upload();
+    // multiplies the model-view-projection of every object on the CPU
+    void update(const glm::mat4& viewProjection);
+    // draws every object with the program in use, texture unit 0 holds the object's texture array
+    void draw(GLuint viewportWidth, GLuint viewportHeight);
+
+    // accessors
+    GLuint getObjectCount() const { return (GLuint)objects.size(); }
+    GLuint getDrawCallCount() const { return (GLuint)groups.size(); }
+    GLuint getPatchCount() const { return patchCount; }    // patches of every surface, each four corners
+
+private:
+    struct Object {
+        ParametricSurface Surface;
+        glm::vec2 Size;
+        GLuint Texture;
+        ObjectData Data;
+    };
+
+    // consecutive objects of one surface, size and texture, one instanced draw
+    struct SurfaceGroup {
+        ParametricSurface Surface;
+        glm::vec2 Size;
+        GLuint Texture;
+        GLuint FirstInstance;
+        GLuint InstanceCount;
+    };
+
+    const GLfloat TargetEdgePixels = 8.0f;     // the edge length on screen SceneBatch aims its levels of detail at
+
+    GLuint vao = 0;
+    GLuint patchBuffer = 0;
+    GLuint objectBuffer = 0;
+    GLuint instanceBuffer = 0;
+
+    // first corner and corner count of each surface's patches
+    GLuint firstCorner[(int)ParametricSurface::Count] = {};
+    GLuint cornerCount[(int)ParametricSurface::Count] = {};
+    GLuint patchCount = 0;
+
+    Uniform<glm::vec2> surfaceSizeUniform;
+    Uniform<glm::vec2> viewportSizeUniform;
+    Uniform<GLfloat> targetEdgePixelsUniform;
+
+    std::vector<Object> objects;
+    std::vector<SurfaceGroup> groups;
+    std::vector<InstanceData> instances;       // kept between frames so updating does not allocate
+
+    void CreatePatches();
+    static void AddPatch(std::vector<glm::vec3>& corners, GLfloat u0, GLfloat v0, GLfloat u1, GLfloat v1, GLfloat region);
+};
@@ -0,0 +1,292 @@
+#include "TextureArray.h"
+#include "GLStateCache.h"
+#include "MipChain.h"
+
+#include <algorithm>
+
+namespace {
+	// mid grey blocks, both endpoints 565 grey so every index decodes to it, BC3 leads with an opaque alpha block
+	const unsigned char GreyBc1Block[8] = { 0x10, 0x84, 0x10, 0x84, 0, 0, 0, 0 };
+	const unsigned char OpaqueAlphaBlock[8] = { 255, 255, 0, 0, 0, 0, 0, 0 };
+	const GLubyte GreyPixel[4] = { 128, 128, 128, 255 };
+
+	bool IsCompressed(LayerFormat format) {
+		return format != LayerFormat::Rgba8;
+	}
+
+	size_t LevelSize(LayerFormat format, GLuint width, GLuint height) {
+		if (!IsCompressed(format))
+			return (size_t)width * height * 4;
+
+		size_t blockSize = format == LayerFormat::Bc1 ? 8 : 16;
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+	}
+}
+
+TextureArray::TextureArray(ShaderLibrary& shaderLibrary) : shaderLibrary(shaderLibrary) {
+	if (GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic) {
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+		maxAnisotropy = std::min(maxAnisotropy, (GLfloat)MaxAnisotropy);
+	}
+
+	glGenFramebuffers(1, &framebuffer);
+	glGenVertexArrays(1, &vertexArray);
+}
+
+TextureArray::~TextureArray() {
+	glDeleteFramebuffers(1, &framebuffer);
+	GLStateCache::get().deleteVertexArrays(1, &vertexArray);
+	if (scratch != 0)
+		GLStateCache::get().deleteTextures(1, &scratch);
+
+	for (Array& array : arrays)
+		if (array.Texture != 0)
+			GLStateCache::get().deleteTextures(1, &array.Texture);
+}
+
+TextureSlot TextureArray::allocate(LayerFormat format, TextureFiltering filtering) {
+	Array& array = arrays[ArrayIndex(format, filtering)];
+
+	// the name exists from the first layer on so objects can be added before the storage does
+	if (array.Texture == 0) {
+		glGenTextures(1, &array.Texture);
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, array.Texture);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, UMipLevelCount(LayerSize, LayerSize) - 1);
+		ApplyFiltering(array.Texture, filtering);
+	}
+
+	// a reused layer still holds its last image until the placeholder goes over it
+	GLuint layer = 0;
+	if (!array.Free.empty()) {
+		layer = array.Free.back();
+		array.Free.pop_back();
+	}
+	else {
+		layer = array.LayerCount++;
+	}
+	array.Unfilled.push_back(layer);
+
+	return ((GLuint)format << 24) | ((GLuint)filtering << 16) | layer;
+}
+
+void TextureArray::release(TextureSlot slot) {
+	arrays[ArrayIndex(getFormat(slot), getFiltering(slot))].Free.push_back(getLayer(slot));
+}
+
+void TextureArray::commit() {
+	for (int index = 0; index < ArrayCount; index++) {
+		Array& array = arrays[index];
+
+		// layers requested together, as at startup, share one allocation
+		if (array.LayerCount > array.Capacity)
+			Grow(index, array.LayerCount);
+
+		for (GLuint layer : array.Unfilled)
+			FillPlaceholder(index, layer);
+		array.Unfilled.clear();
+	}
+}
+
+// each source is drawn over the scratch texture, whose chain is built and copied level by level into the source's
+// layer, so a batch costs the mip levels of its own layers and not those of every layer in the array
+void TextureArray::resample(const std::vector<LayerSource>& sources) {
+	if (sources.empty())
+		return;
+
+	if (layerProgram == nullptr) {
+		layerProgram = shaderLibrary.get(ProgramId::TextureLayer);
+		textureUniform = layerProgram->uniform<GLint>("uTexture");
+	}
+
+	const GLuint levelCount = UMipLevelCount(LayerSize, LayerSize);
+	if (scratch == 0) {
+		glGenTextures(1, &scratch);
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D, scratch);
+		glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_RGBA8, LayerSize, LayerSize);
+	}
+
+	// everything the layer draw changes is put back for the caller, a wireframe or culled frame must not reach a layer
+	GLint drawFramebuffer = 0, viewport[4] = {}, polygonMode[2] = {}, program = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+	const GLboolean blend = glIsEnabled(GL_BLEND);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scratch, 0);
+	glViewport(0, 0, LayerSize, LayerSize);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_BLEND);
+
+	layerProgram->use();
+	textureUniform.set(0);
+	GLStateCache::get().bindVertexArray(vertexArray);
+	GLStateCache::get().activeTexture(GL_TEXTURE0);
+
+	// each source is drawn over the whole layer with its own filtering, whatever its size or format
+	for (const LayerSource& source : sources) {
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D, source.Texture);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D, scratch);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		const GLuint target = getTexture(source.Slot);
+		for (GLuint level = 0, size = LayerSize; level < levelCount; level++, size = std::max(size / 2, 1u))
+			glCopyImageSubData(scratch, GL_TEXTURE_2D, level, 0, 0, 0, target, GL_TEXTURE_2D_ARRAY, level, 0, 0, getLayer(source.Slot), size, size, 1);
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	if (cullFace)
+		glEnable(GL_CULL_FACE);
+	if (blend)
+		glEnable(GL_BLEND);
+	GLStateCache::get().useProgram(program);
+	GLStateCache::get().bindVertexArray(0);
+}
+
+GLenum TextureArray::getInternalFormat(LayerFormat format) {
+	switch (format) {
+	case LayerFormat::Bc1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case LayerFormat::Bc3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	default:
+		return GL_RGBA8;
+	}
+}
+
+size_t TextureArray::getLayerSize(LayerFormat format) {
+	size_t size = 0;
+	for (GLuint level = 0, width = LayerSize, height = LayerSize; level < UMipLevelCount(LayerSize, LayerSize); level++) {
+		size += LevelSize(format, width, height);
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+	return size;
+}
+
+GLuint TextureArray::getLayerCount() const {
+	GLuint count = 0;
+	for (const Array& array : arrays)
+		count += array.LayerCount - (GLuint)array.Free.size();
+	return count;
+}
+
+GLuint TextureArray::getLayerCount(LayerFormat format) const {
+	GLuint count = 0;
+	for (int index = 0; index < ArrayCount; index++)
+		if (FormatOf(index) == format)
+			count += arrays[index].LayerCount - (GLuint)arrays[index].Free.size();
+	return count;
+}
+
+size_t TextureArray::getResidentSize() const {
+	size_t size = 0;
+	for (int index = 0; index < ArrayCount; index++)
+		size += arrays[index].Capacity * getLayerSize(FormatOf(index));
+	return size;
+}
+
+void TextureArray::overrideFiltering(TextureFiltering filtering) {
+	for (const Array& array : arrays)
+		if (array.Texture != 0)
+			ApplyFiltering(array.Texture, filtering);
+}
+
+void TextureArray::restoreFiltering() {
+	for (int index = 0; index < ArrayCount; index++)
+		if (arrays[index].Texture != 0)
+			ApplyFiltering(arrays[index].Texture, FilteringOf(index));
+}
+
+// respecifies the array with room for capacity layers under the same name, the layers it had are copied through
+// a temporary array and back
+void TextureArray::Grow(int index, GLuint capacity) {
+	Array& array = arrays[index];
+	const LayerFormat format = FormatOf(index);
+	const GLuint levelCount = UMipLevelCount(LayerSize, LayerSize);
+
+	GLuint copy = 0;
+	if (array.Capacity > 0) {
+		glGenTextures(1, &copy);
+		Specify(format, copy, array.Capacity);
+
+		for (GLuint level = 0, size = LayerSize; level < levelCount; level++, size = std::max(size / 2, 1u))
+			glCopyImageSubData(array.Texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, copy, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, size, size, array.Capacity);
+	}
+
+	Specify(format, array.Texture, capacity);
+
+	if (copy != 0) {
+		for (GLuint level = 0, size = LayerSize; level < levelCount; level++, size = std::max(size / 2, 1u))
+			glCopyImageSubData(copy, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, array.Texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, size, size, array.Capacity);
+		GLStateCache::get().deleteTextures(1, &copy);
+	}
+
+	array.Capacity = capacity;
+}
+
+// undefined storage for every level of capacity layers
+void TextureArray::Specify(LayerFormat format, GLuint texture, GLuint capacity) {
+	const GLenum internalFormat = getInternalFormat(format);
+
+	GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+	for (GLuint level = 0, size = LayerSize; level < UMipLevelCount(LayerSize, LayerSize); level++, size = std::max(size / 2, 1u)) {
+		if (IsCompressed(format))
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, size, size, capacity, 0, (GLsizei)(LevelSize(format, size, size) * capacity), nullptr);
+		else
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, size, size, capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+}
+
+// every level of the layer mid grey until its image arrives
+void TextureArray::FillPlaceholder(int index, GLuint layer) {
+	const LayerFormat format = FormatOf(index);
+	const GLuint texture = arrays[index].Texture;
+	const GLuint levelCount = UMipLevelCount(LayerSize, LayerSize);
+
+	if (!IsCompressed(format)) {
+		for (GLuint level = 0, size = LayerSize; level < levelCount; level++, size = std::max(size / 2, 1u))
+			glClearTexSubImage(texture, level, 0, 0, layer, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, GreyPixel);
+		return;
+	}
+
+	// the blocks of the largest level, the smaller levels read the start of it
+	const size_t blockSize = format == LayerFormat::Bc1 ? 8 : 16;
+	std::vector<unsigned char> blocks(LevelSize(format, LayerSize, LayerSize));
+	for (size_t offset = 0; offset < blocks.size(); offset += blockSize) {
+		if (format == LayerFormat::Bc3)
+			std::copy(OpaqueAlphaBlock, OpaqueAlphaBlock + 8, blocks.begin() + offset);
+		std::copy(GreyBc1Block, GreyBc1Block + 8, blocks.begin() + offset + blockSize - 8);
+	}
+
+	GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+	for (GLuint level = 0, size = LayerSize; level < levelCount; level++, size = std::max(size / 2, 1u))
+		glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size, size, 1, getInternalFormat(format), (GLsizei)LevelSize(format, size, size), blocks.data());
+}
+
+// sets the sampling of an array
+void TextureArray::ApplyFiltering(GLuint texture, TextureFiltering filtering) {
+	GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filtering == TextureFiltering::Bilinear ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	if (maxAnisotropy > 1.0f)
+		glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, filtering == TextureFiltering::Anisotropic ? maxAnisotropy : 1.0f);
+}
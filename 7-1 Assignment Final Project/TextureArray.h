@@ -0,0 +1,112 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <vector>
+
+#include "Ktx2.h"
+#include "ShaderLibrary.h"
+
+// how a texture is sampled where it is minified, chosen per texture, the layers of one array share it
+enum class TextureFiltering {
+    Bilinear,       // the full size image only, the mip chain is never sampled
+    Trilinear,      // blends the two nearest mip levels
+    Anisotropic,    // trilinear with up to MaxAnisotropy samples along the direction the texture is squeezed
+    Count
+};
+
+// the kinds of storage a layer can be in
+enum class LayerFormat {
+    Bc1 = 0,        // images texcook cooked without alpha, their blocks copied in as they are
+    Bc3,            // images texcook cooked with alpha
+    Rgba8,          // images decoded at load time
+    Count
+};
+
+typedef GLuint TextureSlot;     // the layer's format in bits 24 and up, its filtering in bits 16 to 23 and its layer in the low 16
+
+// one image as a source for a layer of an RGBA8 array
+struct LayerSource {
+    TextureSlot Slot;
+    GLuint Texture;     // a 2D texture of any size with its mip chain
+};
+
+// every texture of the scene as a layer of one of a few GL_TEXTURE_2D_ARRAY textures, one per layer format and
+// filtering, so objects with different textures draw from one binding per array and the layer travels with each
+// object's material
+// layers are allocated as images are requested and grey until filled, a released layer is handed to the next image of
+// its array and the storage only grows, in place so the texture names the batches hold stay valid
+class TextureArray {
+
+public:
+    static const GLuint LayerSize = CookedTextureSize;     // width and height of every layer, texcook cooks to it
+    static const TextureSlot InvalidSlot = ~0u;
+
+    // samples per pixel of anisotropic filtering, less where the driver offers less
+    static const GLuint MaxAnisotropy = 8;
+
+    // the texture layer program is only fetched from the library once an image is resampled
+    explicit TextureArray(ShaderLibrary& shaderLibrary);
+    ~TextureArray();
+
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    // behavior
+    // a layer of the array of that format and filtering, one released earlier when there is one, grey once committed
+    TextureSlot allocate(LayerFormat format, TextureFiltering filtering);
+    // returns the layer for reuse, nothing may draw from it any more
+    void release(TextureSlot slot);
+    // gives every allocated layer its storage and its grey placeholder, before anything is uploaded or drawn
+    void commit();
+    // renders each source over its RGBA8 layer and builds the mip chain of those layers alone
+    void resample(const std::vector<LayerSource>& sources);
+
+    // accessors
+    static LayerFormat getFormat(TextureSlot slot) { return (LayerFormat)(slot >> 24); }
+    static TextureFiltering getFiltering(TextureSlot slot) { return (TextureFiltering)((slot >> 16) & 0xFF); }
+    static GLuint getLayer(TextureSlot slot) { return slot & 0xFFFF; }
+    static GLenum getInternalFormat(LayerFormat format);
+    static size_t getLayerSize(LayerFormat format);     // bytes of one layer with every mip level
+    GLuint getTexture(TextureSlot slot) const { return GetArray(slot).Texture; }   // the array the slot is a layer of
+    GLuint getLayerCount() const;                       // allocated and not released, of every array
+    GLuint getLayerCount(LayerFormat format) const;     // allocated and not released, of the arrays of one format
+    size_t getResidentSize() const;                     // storage of every array
+
+    // mutators
+    // samples every array this way whatever its textures chose, for measuring one filtering against another
+    void overrideFiltering(TextureFiltering filtering);
+    // samples each array with its own filtering again
+    void restoreFiltering();
+
+private:
+    static const int ArrayCount = (int)LayerFormat::Count * (int)TextureFiltering::Count;
+
+    struct Array {
+        GLuint Texture = 0;
+        GLuint LayerCount = 0;      // ever allocated, the layers below it are in use or free
+        GLuint Capacity = 0;        // with storage
+        std::vector<GLuint> Unfilled;   // layers waiting for their placeholder
+        std::vector<GLuint> Free;       // released, reused before LayerCount grows
+    };
+
+    ShaderLibrary& shaderLibrary;
+    Shader* layerProgram = nullptr;
+    Uniform<GLint> textureUniform;
+
+    Array arrays[ArrayCount];       // by format, then filtering
+    GLfloat maxAnisotropy = 1.0f;
+
+    GLuint framebuffer = 0;
+    GLuint vertexArray = 0;         // empty, the triangle is made from gl_VertexID
+    GLuint scratch = 0;             // a 2D texture of one layer where resampled images build their mip chain
+
+    static int ArrayIndex(LayerFormat format, TextureFiltering filtering) { return (int)format * (int)TextureFiltering::Count + (int)filtering; }
+    static LayerFormat FormatOf(int index) { return (LayerFormat)(index / (int)TextureFiltering::Count); }
+    static TextureFiltering FilteringOf(int index) { return (TextureFiltering)(index % (int)TextureFiltering::Count); }
+    const Array& GetArray(TextureSlot slot) const { return arrays[ArrayIndex(getFormat(slot), getFiltering(slot))]; }
+    void Grow(int index, GLuint capacity);
+    void Specify(LayerFormat format, GLuint texture, GLuint capacity);
+    void FillPlaceholder(int index, GLuint layer);
+    void ApplyFiltering(GLuint texture, TextureFiltering filtering);
+};
@@ -0,0 +1,98 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cctype>       // tolower
+#include <vector>
+
+TextureCache::TextureCache(TextureLoader& loader) : loader(loader) {
+}
+
+TextureCache::~TextureCache() {
+	for (const std::pair<const std::string, Entry>& entry : entries)
+		loader.release(entry.second.Slot);
+}
+
+TextureSlot TextureCache::acquire(const char* path, TextureFiltering filtering) {
+	std::string key = normalize(path);
+
+	std::map<std::string, Entry>::iterator entry = entries.find(key);
+	if (entry != entries.end()) {
+		entry->second.References++;
+		sharedCount++;
+		return entry->second.Slot;
+	}
+
+	// the loader opens the path as given and finds its cooked file by the same normalized key
+	TextureSlot slot = loader.load(path, filtering);
+	entries[key] = { slot, 1 };
+	paths[slot] = key;
+	return slot;
+}
+
+void TextureCache::release(TextureSlot slot) {
+	std::map<TextureSlot, std::string>::iterator path = paths.find(slot);
+	if (path == paths.end())
+		return;
+
+	std::map<std::string, Entry>::iterator entry = entries.find(path->second);
+	if (--entry->second.References > 0)
+		return;
+
+	loader.release(slot);
+	entries.erase(entry);
+	paths.erase(path);
+	evictedCount++;
+}
+
+std::string TextureCache::normalize(const std::string& path) {
+	std::string key = path;
+	std::replace(key.begin(), key.end(), '\\', '/');
+
+#ifdef _WIN32
+	std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+#endif
+
+	const bool absolute = !key.empty() && key[0] == '/';
+
+	// empty and "." segments drop out, ".." takes the segment before it unless there is none to take
+	std::vector<std::string> segments;
+	size_t start = 0;
+	while (start <= key.size()) {
+		size_t end = std::min(key.find('/', start), key.size());
+		std::string segment = key.substr(start, end - start);
+		start = end + 1;
+
+		if (segment.empty() || segment == ".")
+			continue;
+		if (segment == ".." && !segments.empty() && segments.back() != "..")
+			segments.pop_back();
+		else
+			segments.push_back(segment);
+	}
+
+	std::string normalized = absolute ? "/" : "";
+	for (size_t i = 0; i < segments.size(); i++)
+		normalized += (i > 0 ? "/" : "") + segments[i];
+	return normalized;
+}
+
+GLuint TextureCache::getReferenceCount() const {
+	GLuint references = 0;
+	for (const std::pair<const std::string, Entry>& entry : entries)
+		references += entry.second.References;
+	return references;
+}
+
+size_t TextureCache::getResidentSize() const {
+	size_t size = 0;
+	for (const std::pair<const std::string, Entry>& entry : entries)
+		size += TextureArray::getLayerSize(TextureArray::getFormat(entry.second.Slot));
+	return size;
+}
+
+size_t TextureCache::getSharedSize() const {
+	size_t size = 0;
+	for (const std::pair<const std::string, Entry>& entry : entries)
+		size += TextureArray::getLayerSize(TextureArray::getFormat(entry.second.Slot)) * (entry.second.References - 1);
+	return size;
+}
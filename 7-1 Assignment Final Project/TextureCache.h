@@ -0,0 +1,52 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <map>
+#include <string>
+
+#include "TextureLoader.h"
+
+// one texture array layer per image file however many shapes and materials name it, keyed by the normalized path
+// every acquire holds a reference, the first allocates the layer through the loader and the last release frees it for
+// the next image, whatever is still held goes when the cache does
+class TextureCache {
+
+public:
+    // the loader allocates the layers and loads their images, it must outlive the cache
+    explicit TextureCache(TextureLoader& loader);
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // behavior
+    // the slot of the image at path, loaded on the first acquire, later ones keep the filtering it was loaded with
+    TextureSlot acquire(const char* path, TextureFiltering filtering = TextureFiltering::Anisotropic);
+    // drops one reference and evicts the image with its last one
+    void release(TextureSlot slot);
+    // the key a path is cached under, separators made forward, "." and ".." segments resolved and, on Windows,
+    // lower case so every spelling of a file finds the same texture
+    static std::string normalize(const std::string& path);
+
+    // accessors
+    GLuint getTextureCount() const { return (GLuint)entries.size(); }
+    GLuint getReferenceCount() const;       // acquires not yet released, across every texture
+    GLuint getSharedCount() const { return sharedCount; }       // acquires served by a texture already loaded
+    GLuint getEvictedCount() const { return evictedCount; }
+    size_t getResidentSize() const;         // bytes of the layers of every texture held, with their mip chains
+    size_t getSharedSize() const;           // bytes a texture per acquire would have taken beyond getResidentSize
+
+private:
+    struct Entry {
+        TextureSlot Slot;
+        GLuint References;
+    };
+
+    TextureLoader& loader;
+
+    std::map<std::string, Entry> entries;       // by normalized path
+    std::map<TextureSlot, std::string> paths;   // normalized path of each slot, for release
+    GLuint sharedCount = 0;
+    GLuint evictedCount = 0;
+};
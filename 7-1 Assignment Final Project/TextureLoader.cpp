@@ -0,0 +1,429 @@
+#include "TextureLoader.h"
+#include "GLStateCache.h"
+#include "TextureCache.h"
+#include "MipChain.h"
+#include "Ktx2.h"
+
+#include <GLFW/glfw3.h>     // glfwGetTime
+#include <stb_image.h>      // image loading header, implemented in Main.cpp
+
+#include <algorithm>
+#include <cstdint>     // SIZE_MAX
+#include <cstring>
+#include <fstream>
+#include <iomanip>     // quoted
+#include <iostream>
+#include <iterator>    // make_move_iterator
+#include <sstream>
+#include <utility>     // move
+
+TextureLoader::TextureLoader(TextureArray& layers, MipGeneration mipGeneration) : layers(layers), mipGeneration(mipGeneration) {
+	glGenBuffers(1, &pixelBuffer);
+	startTime = glfwGetTime();
+
+	if (GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic) {
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+		maxAnisotropy = std::min(maxAnisotropy, (GLfloat)TextureArray::MaxAnisotropy);
+	}
+
+	// GL keeps rows bottom up, set before any decoder reads it
+	stbi_set_flip_vertically_on_load(true);
+
+	GLuint threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	for (GLuint i = 0; i < threadCount; i++)
+		decoders.emplace_back(&TextureLoader::DecodeLoop, this);
+}
+
+TextureLoader::~TextureLoader() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();       // images not started yet are dropped
+	}
+	jobReady.notify_all();
+
+	for (std::thread& decoder : decoders)
+		decoder.join();
+
+	for (DecodedImage& image : decoded)
+		stbi_image_free(image.Pixels);
+	for (DecodedImage& image : uploading)
+		stbi_image_free(image.Pixels);
+
+	GLStateCache::get().deleteBuffers(1, &pixelBuffer);
+}
+
+GLuint TextureLoader::loadCookedIndex(const std::string& path) {
+	std::ifstream file(path);
+	if (!file)
+		return 0;
+
+	if (!GLEW_EXT_texture_compression_s3tc) {
+		std::cout << "INFO: Cooked textures need S3TC compression, decoding the source images instead" << std::endl;
+		return 0;
+	}
+
+	// the index names files relative to its own directory
+	size_t separator = path.find_last_of("\\/");
+	std::string directory = separator == std::string::npos ? "" : path.substr(0, separator + 1);
+
+	std::string line;
+	GLuint count = 0;
+	while (std::getline(file, line)) {
+		std::istringstream fields(line);
+		std::string statement, source, cooked;
+
+		// comments and anything but texture statements are skipped
+		if (!(fields >> statement) || statement != "texture")
+			continue;
+		if (!(fields >> std::quoted(source) >> std::quoted(cooked))) {
+			std::cout << "ERROR::TEXTURE::INDEX_PARSE_FAILED " << path << ": " << line << std::endl;
+			continue;
+		}
+
+		// keyed the way the cache keys images, any spelling of the source finds its cooked file
+		cookedPaths[TextureCache::normalize(directory + source)] = directory + cooked;
+		count++;
+	}
+
+	std::cout << "INFO: " << count << " cooked textures named by " << path << std::endl;
+	return count;
+}
+
+TextureSlot TextureLoader::load(const char* path, TextureFiltering filtering) {
+	std::map<std::string, std::string>::const_iterator cooked = cookedPaths.find(TextureCache::normalize(path));
+	std::string cookedPath = cooked != cookedPaths.end() ? cooked->second : std::string();
+
+	// a cooked file that cannot fill a compressed layer is ignored and the source image decoded in its place
+	LayerFormat format = cookedPath.empty() ? LayerFormat::Rgba8 : CookedFormat(cookedPath);
+	if (format == LayerFormat::Rgba8)
+		cookedPath.clear();
+
+	TextureSlot slot = layers.allocate(format, filtering);
+	pending.insert(slot);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back({ slot, path, cookedPath });
+	}
+	jobReady.notify_one();
+
+	return slot;
+}
+
+void TextureLoader::release(TextureSlot slot) {
+	if (pending.count(slot) != 0) {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::deque<DecodeJob>::iterator job = std::find_if(jobs.begin(), jobs.end(), [slot](const DecodeJob& queued) { return queued.Slot == slot; });
+
+		// a decoder has the image already, the layer is freed when UploadDecoded meets it so the image cannot land
+		// in a layer handed to another
+		if (job == jobs.end()) {
+			released.insert(slot);
+			return;
+		}
+
+		jobs.erase(job);
+		pending.erase(slot);
+	}
+
+	layers.release(slot);
+}
+
+void TextureLoader::update() {
+	// layers requested since the last call get their storage and placeholder before anything draws with them
+	layers.commit();
+	if (pending.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		uploading.insert(uploading.end(), std::make_move_iterator(decoded.begin()), std::make_move_iterator(decoded.end()));
+		decoded.clear();
+	}
+
+	UploadDecoded(UploadBytesPerUpdate);
+}
+
+void TextureLoader::finish() {
+	layers.commit();
+
+	while (!pending.empty()) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			imageReady.wait(lock, [this] { return !decoded.empty() || !uploading.empty(); });
+
+			uploading.insert(uploading.end(), std::make_move_iterator(decoded.begin()), std::make_move_iterator(decoded.end()));
+			decoded.clear();
+		}
+
+		UploadDecoded(SIZE_MAX);
+	}
+}
+
+void TextureLoader::DecodeLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;) {
+		jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+		if (stopping)
+			return;
+
+		DecodeJob job = jobs.front();
+		jobs.pop_front();
+
+		// the decode runs unlocked, several images decode at once on several threads
+		lock.unlock();
+		DecodedImage image;
+		image.Slot = job.Slot;
+		image.Path = job.Path;
+
+		// a compressed layer can only take the cooked blocks, the source image is decoded for an RGBA8 layer alone
+		if (!job.CookedPath.empty()) {
+			ReadCooked(job.CookedPath, image);
+		}
+		else {
+			image.Pixels = stbi_load(job.Path.c_str(), &image.Width, &image.Height, &image.Channels, 0);
+			if (image.Pixels != nullptr && (image.Channels == 3 || image.Channels == 4) && mipGeneration == MipGeneration::Cpu)
+				BuildLayerLevels(image);
+		}
+		lock.lock();
+
+		// moved rather than copied here and into uploading, the cooked file and mip levels run to megabytes
+		decoded.push_back(std::move(image));
+		imageReady.notify_all();
+	}
+}
+
+// uploads the oldest decoded images until byteBudget is spent, always at least one
+void TextureLoader::UploadDecoded(size_t byteBudget) {
+	size_t uploadedBytes = 0;
+	size_t uploadedCount = 0;
+
+	while (uploadedCount < uploading.size() && (uploadedCount == 0 || uploadedBytes < byteBudget)) {
+		const DecodedImage& image = uploading[uploadedCount++];
+		pending.erase(image.Slot);
+
+		if (released.erase(image.Slot) != 0) {
+			stbi_image_free(image.Pixels);
+			layers.release(image.Slot);
+			continue;
+		}
+
+		if (!image.Cooked.empty()) {
+			UploadCooked(image);
+			uploadedBytes += image.Cooked.size();
+		}
+		else if (!image.LayerLevels.empty()) {
+			UploadLayerLevels(image);
+			uploadedBytes += image.LayerLevels.size();
+		}
+		else {
+			Upload(image);
+			uploadedBytes += (size_t)image.Width * image.Height * image.Channels;
+		}
+	}
+
+	uploading.erase(uploading.begin(), uploading.begin() + uploadedCount);
+
+	// the decoded images are drawn into their layers together and their 2D textures deleted
+	layers.resample(resampling);
+	for (const LayerSource& source : resampling)
+		GLStateCache::get().deleteTextures(1, &source.Texture);
+	resampling.clear();
+}
+
+// copies the pixels into the pixel buffer and lets the driver move them into a 2D texture without stalling the frame,
+// the texture gets its chain from glGenerateMipmap and is queued to be rendered into the image's RGBA8 layer
+void TextureLoader::Upload(const DecodedImage& image) {
+	if (image.Pixels == nullptr || (image.Channels != 3 && image.Channels != 4)) {
+		std::cout << "ERROR::TEXTURE::LOAD_FAILED " << image.Path << ", the placeholder stays in place" << std::endl;
+		stbi_image_free(image.Pixels);
+		return;
+	}
+
+	size_t size = (size_t)image.Width * image.Height * image.Channels;
+	GLuint levelCount = UMipLevelCount(image.Width, image.Height);
+
+	// orphaning the old storage lets the driver keep transferring the previous image while this one is copied
+	GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped != nullptr) {
+		memcpy(mapped, image.Pixels, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D, texture);
+
+		// resampled into a layer of another size, the mip chain and anisotropy keep the minified source from aliasing
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (maxAnisotropy > 1.0f)
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, maxAnisotropy);
+
+		// RGB rows are not padded to four bytes
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		GLenum internalFormat = image.Channels == 3 ? GL_RGB8 : GL_RGBA8;
+		GLenum format = image.Channels == 3 ? GL_RGB : GL_RGBA;
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.Width, image.Height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D, 0);
+
+		resampling.push_back({ image.Slot, texture });
+	}
+
+	GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	stbi_image_free(image.Pixels);
+
+	std::cout << "INFO: Texture " << image.Path << " " << image.Width << " x " << image.Height << " and " << levelCount - 1
+	          << " mip levels built on the GPU, resampled into RGBA8 layer "
+	          << TextureArray::getLayer(image.Slot) << " after " << (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+}
+
+// the layer format a cooked file can fill, read from its header and level index on the GL thread as the image is
+// requested, Rgba8 when the file is missing, damaged or was not cooked at the layer size with a whole mip chain
+LayerFormat TextureLoader::CookedFormat(const std::string& path) const {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return LayerFormat::Rgba8;
+
+	const uint64_t fileSize = (uint64_t)file.tellg();
+	const GLuint levelCount = UMipLevelCount(TextureArray::LayerSize, TextureArray::LayerSize);
+
+	Ktx2Header header;
+	std::vector<Ktx2Level> levels(levelCount);
+	file.seekg(0);
+	if (!file.read((char*)&header, sizeof(header)) || memcmp(header.Identifier, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0)
+		return LayerFormat::Rgba8;
+	if (header.VkFormat != Ktx2FormatBc1RgbUnorm && header.VkFormat != Ktx2FormatBc3Unorm)
+		return LayerFormat::Rgba8;
+
+	if (header.PixelWidth != TextureArray::LayerSize || header.PixelHeight != TextureArray::LayerSize || header.LevelCount != levelCount) {
+		std::cout << "INFO: Cooked texture " << path << " is " << header.PixelWidth << " x " << header.PixelHeight
+		          << ", not the layer size, decoding the source image instead, cook it again with texcook" << std::endl;
+		return LayerFormat::Rgba8;
+	}
+
+	if (!file.read((char*)levels.data(), sizeof(Ktx2Level) * levelCount))
+		return LayerFormat::Rgba8;
+
+	// every level must be the size its layer level takes and lie inside the file
+	const LayerFormat format = header.VkFormat == Ktx2FormatBc3Unorm ? LayerFormat::Bc3 : LayerFormat::Bc1;
+	for (GLuint level = 0, size = TextureArray::LayerSize; level < levelCount; level++, size = std::max(size / 2, 1u)) {
+		const uint64_t expected = (uint64_t)((size + 3) / 4) * ((size + 3) / 4) * UKtx2BlockSize(header.VkFormat);
+		if (levels[level].ByteLength != expected || levels[level].ByteOffset > fileSize || levels[level].ByteLength > fileSize - levels[level].ByteOffset)
+			return LayerFormat::Rgba8;
+	}
+
+	return format;
+}
+
+// reads a cooked file on the decoder thread, the image stays empty and its layer grey when the file no longer holds
+// the layer CookedFormat found in it
+void TextureLoader::ReadCooked(const std::string& path, DecodedImage& image) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return;
+
+	std::vector<unsigned char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	Ktx2Header header;
+	const Ktx2Level* levels = nullptr;
+	if (!UReadKtx2(contents.data(), contents.size(), header, levels))
+		return;
+	if (header.PixelWidth != TextureArray::LayerSize || header.PixelHeight != TextureArray::LayerSize || header.LevelCount != UMipLevelCount(TextureArray::LayerSize, TextureArray::LayerSize))
+		return;
+	if ((header.VkFormat == Ktx2FormatBc3Unorm) != (TextureArray::getFormat(image.Slot) == LayerFormat::Bc3))
+		return;
+
+	image.Width = (int)header.PixelWidth;
+	image.Height = (int)header.PixelHeight;
+	image.Channels = header.VkFormat == Ktx2FormatBc3Unorm ? 4 : 3;
+	image.Cooked.swap(contents);
+}
+
+// copies the cooked file into the pixel buffer and each level's blocks from there into the image's layer of its
+// compressed array as texcook wrote them, nothing is decoded or resampled
+void TextureLoader::UploadCooked(const DecodedImage& image) {
+	Ktx2Header header;
+	const Ktx2Level* levels = nullptr;
+	UReadKtx2(image.Cooked.data(), image.Cooked.size(), header, levels);     // already checked by ReadCooked
+
+	const LayerFormat format = TextureArray::getFormat(image.Slot);
+
+	GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, image.Cooked.size(), nullptr, GL_STREAM_DRAW);
+
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, image.Cooked.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped != nullptr) {
+		memcpy(mapped, image.Cooked.data(), image.Cooked.size());
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, layers.getTexture(image.Slot));
+
+		// the level index gives each level's place in the file, which is its place in the pixel buffer
+		GLuint size = TextureArray::LayerSize;
+		for (GLuint level = 0; level < header.LevelCount; level++, size = std::max(size / 2, 1u))
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, TextureArray::getLayer(image.Slot), size, size, 1,
+			                          TextureArray::getInternalFormat(format), (GLsizei)levels[level].ByteLength, (const void*)(size_t)levels[level].ByteOffset);
+	}
+
+	GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	std::cout << "INFO: Texture " << image.Path << " " << image.Width << " x " << image.Height << " and " << header.LevelCount - 1
+	          << " mip levels cooked, copied into " << (format == LayerFormat::Bc3 ? "BC3" : "BC1") << " layer "
+	          << TextureArray::getLayer(image.Slot) << " after " << (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+}
+
+// the image scaled to the layer size and the whole chain below it, run on the decoder thread so several images
+// scale and downsample at once, the decoded pixels are freed here
+void TextureLoader::BuildLayerLevels(DecodedImage& image) {
+	const size_t layerSize = (size_t)TextureArray::LayerSize * TextureArray::LayerSize * image.Channels;
+	image.LayerLevels.resize(layerSize + UMipChainSize(TextureArray::LayerSize, TextureArray::LayerSize, image.Channels));
+
+	UResampleBox(image.Pixels, image.Width, image.Height, image.LayerLevels.data(), TextureArray::LayerSize, TextureArray::LayerSize, image.Channels);
+	UBuildMipChain(image.LayerLevels.data(), TextureArray::LayerSize, TextureArray::LayerSize, image.Channels, image.LayerLevels.data() + layerSize);
+
+	stbi_image_free(image.Pixels);
+	image.Pixels = nullptr;
+}
+
+// copies every level the decoder built into the pixel buffer and from there straight into the image's RGBA8 layer,
+// nothing is rendered or mipmapped on the GPU
+void TextureLoader::UploadLayerLevels(const DecodedImage& image) {
+	GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, image.LayerLevels.size(), nullptr, GL_STREAM_DRAW);
+
+	const GLuint levelCount = UMipLevelCount(TextureArray::LayerSize, TextureArray::LayerSize);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, image.LayerLevels.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped != nullptr) {
+		memcpy(mapped, image.LayerLevels.data(), image.LayerLevels.size());
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		// RGB rows are not padded to four bytes
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		GLStateCache::get().bindTexture(GL_TEXTURE_2D_ARRAY, layers.getTexture(image.Slot));
+
+		// the levels follow one another in the pixel buffer, each tightly packed
+		const GLenum format = image.Channels == 3 ? GL_RGB : GL_RGBA;
+		size_t offset = 0;
+		for (GLuint level = 0, size = TextureArray::LayerSize; level < levelCount; level++, size = std::max(size / 2, 1u)) {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, TextureArray::getLayer(image.Slot), size, size, 1, format, GL_UNSIGNED_BYTE, (const void*)offset);
+			offset += (size_t)size * size * image.Channels;
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	GLStateCache::get().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	std::cout << "INFO: Texture " << image.Path << " " << image.Width << " x " << image.Height << " scaled to " << TextureArray::LayerSize
+	          << " x " << TextureArray::LayerSize << " and " << levelCount - 1 << " mip levels built on the CPU, copied into RGBA8 layer "
+	          << TextureArray::getLayer(image.Slot) << " after " << (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+}
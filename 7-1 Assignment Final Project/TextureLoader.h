@@ -0,0 +1,105 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TextureArray.h"
+
+// where the mip chain of each decoded image's layer is built, cooked images bring the chain texcook built
+enum class MipGeneration {
+    Gpu,        // the image is rendered into a texture of the layer size and glGenerateMipmap builds the chain there
+    Cpu         // scaled to the layer size and box filtered on the decoder threads, every level copied into the layer
+};
+
+// decodes image files on worker threads and streams them into layers of the texture array through a pixel buffer object
+// a requested texture has its layer at once, grey until the image arrives, so objects can draw with it straight away
+// images the texcook tool has cooked are read as compressed blocks and copied level by level into their layer of a
+// compressed array, any other image fills a layer of an RGBA8 array as its MipGeneration says
+class TextureLoader {
+
+public:
+    // images larger than this are still uploaded one per update
+    static const size_t UploadBytesPerUpdate = 16 * 1024 * 1024;
+
+    // one decode thread per hardware thread besides the GL thread, the layers must outlive the loader
+    explicit TextureLoader(TextureArray& layers, MipGeneration mipGeneration = MipGeneration::Gpu);
+    ~TextureLoader();
+
+    // behavior
+    // reads the textures.index texcook writes, later loads of the images it names read the cooked files instead,
+    // returns how many it names or 0 when there is no index or the driver cannot sample the compressed formats
+    GLuint loadCookedIndex(const std::string& path);
+    // allocates the image's layer and queues the image for decoding, in a compressed array when its cooked file
+    // holds a whole layer and in an RGBA8 array otherwise, in either case one sampled with the given filtering
+    TextureSlot load(const char* path, TextureFiltering filtering = TextureFiltering::Anisotropic);
+    // frees the image's layer for the next load, an image still queued is dropped and one already decoding is
+    // discarded once it arrives, its layer freed then
+    void release(TextureSlot slot);
+    // uploads the images decoded since the last call, on the GL thread once per frame
+    void update();
+    // waits for every queued image and uploads it, for measurements that must not see placeholders
+    void finish();
+
+    // accessors
+    GLuint getPendingCount() const { return (GLuint)pending.size(); }     // requested but not yet resident
+    MipGeneration getMipGeneration() const { return mipGeneration; }
+
+private:
+    struct DecodeJob {
+        TextureSlot Slot;
+        std::string Path;
+        std::string CookedPath;     // empty when the image has not been cooked
+    };
+
+    struct DecodedImage {
+        TextureSlot Slot = TextureArray::InvalidSlot;
+        std::string Path;
+        unsigned char* Pixels = nullptr;    // null when the file could not be decoded
+        int Width = 0;
+        int Height = 0;
+        int Channels = 0;
+        std::vector<unsigned char> LayerLevels; // CPU mip generation only, the image at the layer size and every level below it
+        std::vector<unsigned char> Cooked;      // the whole cooked KTX2 file in place of Pixels, its levels uploaded as they are
+    };
+
+    TextureArray& layers;
+
+    std::vector<std::thread> decoders;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable imageReady;
+
+    // guarded by mutex
+    std::deque<DecodeJob> jobs;
+    std::vector<DecodedImage> decoded;
+    bool stopping = false;
+
+    const MipGeneration mipGeneration;     // read by the decoders, fixed at construction
+
+    // GL thread only
+    std::map<std::string, std::string> cookedPaths; // cooked file of each source image the index names, by normalized path
+    GLfloat maxAnisotropy = 1.0f;
+    std::vector<DecodedImage> uploading;
+    std::vector<LayerSource> resampling;    // GPU mip generation, images uploaded by this update, rendered into their layers at its end
+    std::set<TextureSlot> pending;          // queued or decoding, includes released slots whose image has not arrived
+    std::set<TextureSlot> released;         // discarded once their image arrives, their layers freed with it
+    GLuint pixelBuffer = 0;
+    double startTime = 0.0;
+
+    void DecodeLoop();
+    void BuildLayerLevels(DecodedImage& image);
+    LayerFormat CookedFormat(const std::string& path) const;
+    void Upload(const DecodedImage& image);
+    void UploadLayerLevels(const DecodedImage& image);
+    void UploadCooked(const DecodedImage& image);
+    void ReadCooked(const std::string& path, DecodedImage& image);
+    void UploadDecoded(size_t byteBudget);
+};
@@ -0,0 +1,105 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+	// set while a thread runs a body, a nested parallelFor would wait on the range it is part of
+	thread_local bool runningBody = false;
+
+	void RunSerially(GLuint count, const std::function<void(GLuint, GLuint)>& body) {
+		bool wasRunning = runningBody;
+		runningBody = true;
+		body(0, count);
+		runningBody = wasRunning;
+	}
+}
+
+ThreadPool& ThreadPool::get() {
+	static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+	return pool;
+}
+
+ThreadPool::ThreadPool(GLuint threadCount) {
+	for (GLuint i = 1; i < threadCount; i++)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workReady.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::parallelFor(GLuint itemCount, const std::function<void(GLuint first, GLuint last)>& rangeBody) {
+	if (itemCount == 0)
+		return;
+
+	if (workers.empty() || runningBody) {
+		RunSerially(itemCount, rangeBody);
+		return;
+	}
+
+	// another thread's range finishes first, the workers only ever hold one
+	std::lock_guard<std::mutex> callerLock(callerMutex);
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// a few chunks per thread so a slow thread does not hold the others up at the end
+	body = &rangeBody;
+	count = itemCount;
+	nextItem = 0;
+	chunkSize = std::max(itemCount / (getThreadCount() * 4), 1u);
+	generation++;
+	workReady.notify_all();
+
+	while (RunChunk(lock))
+		;
+
+	// the last chunks may still be running on workers
+	workDone.wait(lock, [this] { return busyWorkers == 0; });
+	body = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+	GLuint seenGeneration = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;) {
+		workReady.wait(lock, [&] { return stopping || (generation != seenGeneration && body != nullptr); });
+		if (stopping)
+			return;
+
+		seenGeneration = generation;
+
+		busyWorkers++;
+		while (RunChunk(lock))
+			;
+		busyWorkers--;
+
+		if (busyWorkers == 0)
+			workDone.notify_all();
+	}
+}
+
+// takes the next chunk of the range and runs it unlocked, false once the range is used up
+bool ThreadPool::RunChunk(std::unique_lock<std::mutex>& lock) {
+	if (body == nullptr || nextItem >= count)
+		return false;
+
+	GLuint first = nextItem;
+	GLuint last = std::min(first + chunkSize, count);
+	nextItem = last;
+
+	const std::function<void(GLuint, GLuint)>& rangeBody = *body;
+	lock.unlock();
+	runningBody = true;
+	rangeBody(first, last);
+	runningBody = false;
+	lock.lock();
+
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// worker threads that split a range of independent items, used by the mesh generators to build rings in parallel
+// the pool works on one range at a time, callers on other threads wait for it and a call from inside a body runs its
+// range on that thread alone
+class ThreadPool {
+
+public:
+    // one worker per hardware thread besides the caller, which takes a share of every range itself
+    static ThreadPool& get();
+
+    // threadCount counts the calling thread, 1 runs everything on the caller
+    explicit ThreadPool(GLuint threadCount);
+    ~ThreadPool();
+
+    // behavior
+    // calls body(first, last) over contiguous chunks of [0, count) on every thread and returns when all are done
+    // safe from several threads at once, they take turns, and from within a body, where it runs serially
+    void parallelFor(GLuint count, const std::function<void(GLuint first, GLuint last)>& body);
+
+    // accessors
+    GLuint getThreadCount() const { return (GLuint)workers.size() + 1; }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex callerMutex;     // held by the caller whose range the workers are splitting
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+
+    // the range being split, guarded by mutex
+    const std::function<void(GLuint, GLuint)>* body = nullptr;
+    GLuint count = 0;
+    GLuint nextItem = 0;
+    GLuint chunkSize = 1;
+    GLuint busyWorkers = 0;
+    GLuint generation = 0;      // advances with every range so a worker never runs one twice
+    bool stopping = false;
+
+    void WorkerLoop();
+    bool RunChunk(std::unique_lock<std::mutex>& lock);
+};
@@ -0,0 +1,185 @@
+#include "BlockCompression.h"
+#include "../ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+	uint16_t To565(const glm::vec3& color) {
+		int r = std::min((int)(color.r * 31.0f / 255.0f + 0.5f), 31);
+		int g = std::min((int)(color.g * 63.0f / 255.0f + 0.5f), 63);
+		int b = std::min((int)(color.b * 31.0f / 255.0f + 0.5f), 31);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	// the color the GPU decodes an endpoint to, the high bits repeat into the low ones
+	glm::vec3 From565(uint16_t color) {
+		int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		return glm::vec3((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)));
+	}
+
+	// the 16 pixels of the block at column x and row y of blocks, the last row and column repeat past the image
+	void LoadBlock(const unsigned char* pixels, int width, int height, int channels, int x, int y, unsigned char block[16][4]) {
+		for (int row = 0; row < 4; row++) {
+			const unsigned char* line = pixels + (size_t)std::min(y * 4 + row, height - 1) * width * channels;
+
+			for (int column = 0; column < 4; column++) {
+				const unsigned char* pixel = line + (size_t)std::min(x * 4 + column, width - 1) * channels;
+				for (int c = 0; c < 4; c++)
+					block[row * 4 + column][c] = c < channels ? pixel[c] : 255;
+			}
+		}
+	}
+
+	// endpoints at the extremes of the colors along their principal axis, every pixel takes the nearest of the four
+	// colors the endpoints interpolate
+	void EncodeColorBlock(const unsigned char block[16][4], unsigned char* out) {
+		glm::vec3 colors[16];
+		glm::vec3 mean(0.0f), low(FLT_MAX), high(-FLT_MAX);
+		for (int i = 0; i < 16; i++) {
+			colors[i] = glm::vec3(block[i][0], block[i][1], block[i][2]);
+			mean += colors[i] / 16.0f;
+			low = glm::min(low, colors[i]);
+			high = glm::max(high, colors[i]);
+		}
+
+		glm::mat3 covariance(0.0f);
+		for (int i = 0; i < 16; i++) {
+			glm::vec3 offset = colors[i] - mean;
+			covariance += glm::outerProduct(offset, offset);
+		}
+
+		// a few power iterations from the diagonal of the bounding box converge on the principal axis
+		glm::vec3 axis = high - low;
+		for (int iteration = 0; iteration < 4 && glm::dot(axis, axis) > 0.0f; iteration++) {
+			axis = covariance * axis;
+			GLfloat length = glm::length(axis);
+			if (length > 0.0f)
+				axis /= length;
+		}
+
+		int lowest = 0, highest = 0;
+		GLfloat lowestProjection = FLT_MAX, highestProjection = -FLT_MAX;
+		for (int i = 0; i < 16; i++) {
+			GLfloat projection = glm::dot(colors[i], axis);
+			if (projection < lowestProjection) {
+				lowestProjection = projection;
+				lowest = i;
+			}
+			if (projection > highestProjection) {
+				highestProjection = projection;
+				highest = i;
+			}
+		}
+
+		// the larger endpoint first selects the four color mode
+		uint16_t endpoint0 = To565(colors[highest]);
+		uint16_t endpoint1 = To565(colors[lowest]);
+		if (endpoint0 < endpoint1)
+			std::swap(endpoint0, endpoint1);
+
+		uint32_t indices = 0;
+		if (endpoint0 != endpoint1) {
+			glm::vec3 palette[4];
+			palette[0] = From565(endpoint0);
+			palette[1] = From565(endpoint1);
+			palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+			palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+
+			for (int i = 0; i < 16; i++) {
+				uint32_t nearest = 0;
+				GLfloat nearestDistance = FLT_MAX;
+				for (uint32_t p = 0; p < 4; p++) {
+					glm::vec3 offset = colors[i] - palette[p];
+					GLfloat distance = glm::dot(offset, offset);
+					if (distance < nearestDistance) {
+						nearestDistance = distance;
+						nearest = p;
+					}
+				}
+				indices |= nearest << (i * 2);
+			}
+		}
+
+		out[0] = (unsigned char)(endpoint0 & 0xFF);
+		out[1] = (unsigned char)(endpoint0 >> 8);
+		out[2] = (unsigned char)(endpoint1 & 0xFF);
+		out[3] = (unsigned char)(endpoint1 >> 8);
+		for (int i = 0; i < 4; i++)
+			out[4 + i] = (unsigned char)(indices >> (i * 8));
+	}
+
+	// the highest and lowest alpha as endpoints with the six values between them
+	void EncodeAlphaBlock(const unsigned char block[16][4], unsigned char* out) {
+		int alpha0 = 0, alpha1 = 255;
+		for (int i = 0; i < 16; i++) {
+			alpha0 = std::max(alpha0, (int)block[i][3]);
+			alpha1 = std::min(alpha1, (int)block[i][3]);
+		}
+
+		uint64_t indices = 0;
+		if (alpha0 != alpha1) {
+			int palette[8] = { alpha0, alpha1 };
+			for (int p = 2; p < 8; p++)
+				palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1 + 3) / 7;
+
+			for (int i = 0; i < 16; i++) {
+				uint64_t nearest = 0;
+				int nearestDistance = 256;
+				for (int p = 0; p < 8; p++) {
+					int distance = std::abs(block[i][3] - palette[p]);
+					if (distance < nearestDistance) {
+						nearestDistance = distance;
+						nearest = (uint64_t)p;
+					}
+				}
+				indices |= nearest << (i * 3);
+			}
+		}
+
+		out[0] = (unsigned char)alpha0;
+		out[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (unsigned char)(indices >> (i * 8));
+	}
+
+	// the rows of blocks are independent, each thread of the pool compresses a share of them
+	void CompressBlocks(const unsigned char* pixels, int width, int height, int channels, unsigned char* blocks, int blockSize) {
+		int blocksAcross = (width + 3) / 4;
+		int blocksDown = (height + 3) / 4;
+
+		ThreadPool::get().parallelFor((GLuint)blocksDown, [&](GLuint first, GLuint last) {
+			unsigned char block[16][4];
+
+			for (int y = (int)first; y < (int)last; y++) {
+				unsigned char* out = blocks + (size_t)y * blocksAcross * blockSize;
+
+				for (int x = 0; x < blocksAcross; x++, out += blockSize) {
+					LoadBlock(pixels, width, height, channels, x, y, block);
+
+					if (blockSize == 16) {
+						EncodeAlphaBlock(block, out);
+						EncodeColorBlock(block, out + 8);
+					}
+					else {
+						EncodeColorBlock(block, out);
+					}
+				}
+			}
+		});
+	}
+}
+
+size_t UCompressedSize(int width, int height, int blockSize) {
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+void UCompressBc1(const unsigned char* pixels, int width, int height, unsigned char* blocks) {
+	CompressBlocks(pixels, width, height, 3, blocks, 8);
+}
+
+void UCompressBc3(const unsigned char* pixels, int width, int height, unsigned char* blocks) {
+	CompressBlocks(pixels, width, height, 4, blocks, 16);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// BC1 and BC3 encoders for the texcook tool, every 4 x 4 block is fitted along the principal axis of its colors
+
+// bytes of a level of width x height once compressed, partial blocks at the right and top edges count whole
+size_t UCompressedSize(int width, int height, int blockSize);
+
+// compresses an RGB level into BC1 blocks, row after row of blocks starting with the first row of pixels
+void UCompressBc1(const unsigned char* pixels, int width, int height, unsigned char* blocks);
+
+// compresses an RGBA level into BC3 blocks, the alpha block of each followed by its color block
+void UCompressBc3(const unsigned char* pixels, int width, int height, unsigned char* blocks);
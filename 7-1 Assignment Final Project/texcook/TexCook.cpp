@@ -0,0 +1,271 @@
+// texcook: converts every JPEG and PNG image of a directory into a block compressed KTX2 texture of the texture array's
+// layer size with its whole mip chain, and writes textures.index naming the cooked file of each image for the texture
+// loader
+//
+// usage: texcook [directory], the directory defaults to Data
+
+#include <cctype>           // tolower
+#include <cstdlib>          // EXIT_FAILURE
+#include <iomanip>          // quoted
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "BlockCompression.h"
+#include "../Ktx2.h"
+#include "../MipChain.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    // KTX2 level data starts on a multiple of this, a common multiple of both block sizes and of 4
+    constexpr size_t LEVEL_ALIGNMENT = 16;
+
+    // data format descriptor values, from the Khronos data format specification
+    constexpr uint32_t DF_MODEL_BC1A = 128;
+    constexpr uint32_t DF_MODEL_BC3 = 130;
+    constexpr uint32_t DF_PRIMARIES_BT709 = 1;
+    constexpr uint32_t DF_TRANSFER_LINEAR = 1;
+    constexpr uint32_t DF_CHANNEL_BC3_ALPHA = 15;
+}
+
+vector<string> UListImages(const string& directory);
+bool UCookImage(const string& directory, const string& source, ofstream& index);
+void UAppend(vector<unsigned char>& file, const void* data, size_t size);
+void UAppendDataFormat(vector<unsigned char>& file, uint32_t vkFormat);
+void UAppendKeyValue(vector<unsigned char>& file, const string& key, const string& value);
+
+int main(int argc, char* argv[])
+{
+    string directory = argc > 1 ? argv[1] : "Data";
+
+    // GL keeps rows bottom up, the blocks are cooked in that order so the loader uploads them as they are
+    stbi_set_flip_vertically_on_load(true);
+
+    vector<string> sources = UListImages(directory);
+    if (sources.empty()) {
+        cout << "ERROR::TEXCOOK::NO_IMAGES " << directory << endl;
+        return EXIT_FAILURE;
+    }
+
+    ofstream index(directory + "/textures.index");
+    if (!index) {
+        cout << "ERROR::TEXCOOK::INDEX_NOT_WRITTEN " << directory << "/textures.index" << endl;
+        return EXIT_FAILURE;
+    }
+
+    index << "# written by texcook, the cooked file of each source image the texture loader uploads in its place" << endl;
+    index << "# texture \"source\" \"cooked\" format width height levels uncompressed-bytes cooked-bytes" << endl;
+
+    int failures = 0;
+    for (const string& source : sources)
+        if (!UCookImage(directory, source, index))
+            failures++;
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// file names of the JPEG and PNG images directly inside directory, in name order so the index does not churn
+vector<string> UListImages(const string& directory)
+{
+    vector<string> names;
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE search = FindFirstFileA((directory + "\\*").c_str(), &entry);
+    if (search != INVALID_HANDLE_VALUE) {
+        do {
+            if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                names.push_back(entry.cFileName);
+        } while (FindNextFileA(search, &entry));
+        FindClose(search);
+    }
+#else
+    DIR* search = opendir(directory.c_str());
+    if (search != nullptr) {
+        while (dirent* entry = readdir(search))
+            names.push_back(entry->d_name);
+        closedir(search);
+    }
+#endif
+
+    vector<string> images;
+    for (const string& name : names) {
+        string extension = name.substr(min(name.rfind('.'), name.size()));
+        transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+        if (extension == ".jpg" || extension == ".jpeg" || extension == ".png")
+            images.push_back(name);
+    }
+
+    sort(images.begin(), images.end());
+    return images;
+}
+
+// decodes one image, scales it to the layer size, builds its mip chain, compresses every level and writes the KTX2
+// file beside the image
+bool UCookImage(const string& directory, const string& source, ofstream& index)
+{
+    string sourcePath = directory + "/" + source;
+
+    // images with alpha become BC3, everything else BC1 without alpha
+    int width = 0, height = 0, channels = 0;
+    if (!stbi_info(sourcePath.c_str(), &width, &height, &channels)) {
+        cout << "ERROR::TEXCOOK::DECODE_FAILED " << sourcePath << endl;
+        return false;
+    }
+
+    channels = (channels == 2 || channels == 4) ? 4 : 3;
+    unsigned char* decoded = stbi_load(sourcePath.c_str(), &width, &height, nullptr, channels);
+    if (decoded == nullptr) {
+        cout << "ERROR::TEXCOOK::DECODE_FAILED " << sourcePath << endl;
+        return false;
+    }
+
+    // every layer of the texture array is one size, so the loader copies the blocks in without resampling them
+    const int sourceWidth = width, sourceHeight = height;
+    width = height = (int)CookedTextureSize;
+
+    vector<unsigned char> pixels((size_t)width * height * channels);
+    UResampleBox(decoded, sourceWidth, sourceHeight, pixels.data(), width, height, channels);
+    stbi_image_free(decoded);
+
+    vector<unsigned char> chain(UMipChainSize(width, height, channels));
+    UBuildMipChain(pixels.data(), width, height, channels, chain.data());
+
+    const uint32_t vkFormat = channels == 4 ? Ktx2FormatBc3Unorm : Ktx2FormatBc1RgbUnorm;
+    const int blockSize = (int)UKtx2BlockSize(vkFormat);
+    const uint32_t levelCount = UMipLevelCount(width, height);
+
+    // every level compressed, level 0 first
+    vector<vector<unsigned char>> levelBlocks(levelCount);
+    const unsigned char* levelPixels = pixels.data();
+    int levelWidth = width, levelHeight = height;
+
+    for (uint32_t level = 0; level < levelCount; level++) {
+        levelBlocks[level].resize(UCompressedSize(levelWidth, levelHeight, blockSize));
+
+        if (channels == 4)
+            UCompressBc3(levelPixels, levelWidth, levelHeight, levelBlocks[level].data());
+        else
+            UCompressBc1(levelPixels, levelWidth, levelHeight, levelBlocks[level].data());
+
+        levelPixels = (level == 0 ? chain.data() : levelPixels + (size_t)levelWidth * levelHeight * channels);
+        levelWidth = max(levelWidth / 2, 1);
+        levelHeight = max(levelHeight / 2, 1);
+    }
+
+    // the level data must sit at the right offsets, so the descriptor and key values are laid out first
+    vector<unsigned char> file(sizeof(Ktx2Header) + sizeof(Ktx2Level) * levelCount);
+
+    Ktx2Header header = {};
+    memcpy(header.Identifier, Ktx2Identifier, sizeof(Ktx2Identifier));
+    header.VkFormat = vkFormat;
+    header.TypeSize = 1;
+    header.PixelWidth = width;
+    header.PixelHeight = height;
+    header.FaceCount = 1;
+    header.LevelCount = levelCount;
+
+    header.DfdByteOffset = (uint32_t)file.size();
+    UAppendDataFormat(file, vkFormat);
+    header.DfdByteLength = (uint32_t)file.size() - header.DfdByteOffset;
+
+    // keys in byte order as the container requires, the rows run bottom up
+    header.KvdByteOffset = (uint32_t)file.size();
+    UAppendKeyValue(file, "KTXorientation", "ru");
+    UAppendKeyValue(file, "KTXwriter", "texcook 1");
+    header.KvdByteLength = (uint32_t)file.size() - header.KvdByteOffset;
+
+    // the smallest level is stored first
+    vector<Ktx2Level> levels(levelCount);
+    for (uint32_t level = levelCount; level-- > 0;) {
+        file.resize((file.size() + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT);
+
+        levels[level].ByteOffset = file.size();
+        levels[level].ByteLength = levelBlocks[level].size();
+        levels[level].UncompressedByteLength = levelBlocks[level].size();
+        UAppend(file, levelBlocks[level].data(), levelBlocks[level].size());
+    }
+
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), levels.data(), sizeof(Ktx2Level) * levelCount);
+
+    string cooked = source.substr(0, source.rfind('.')) + ".ktx2";
+    ofstream output(directory + "/" + cooked, ios::binary);
+    output.write((const char*)file.data(), file.size());
+
+    size_t uncompressedSize = (size_t)width * height * channels + chain.size();
+
+    if (!output) {
+        cout << "ERROR::TEXCOOK::WRITE_FAILED " << directory << "/" << cooked << endl;
+        return false;
+    }
+
+    const char* formatName = channels == 4 ? "BC3" : "BC1";
+    index << "texture " << quoted(source) << " " << quoted(cooked) << " " << formatName << " " << width << " " << height << " "
+          << levelCount << " " << uncompressedSize << " " << file.size() << endl;
+
+    cout << "INFO: " << source << " " << sourceWidth << " x " << sourceHeight << " cooked to " << cooked << " at " << width << " x " << height << ", " << formatName << " with "
+         << levelCount << " levels, " << uncompressedSize / 1024 << " KB uncompressed to " << file.size() / 1024 << " KB" << endl;
+    return true;
+}
+
+void UAppend(vector<unsigned char>& file, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    file.insert(file.end(), bytes, bytes + size);
+}
+
+// the basic data format descriptor of a BC1 or BC3 texture, one sample per 64 bit half of a block
+void UAppendDataFormat(vector<unsigned char>& file, uint32_t vkFormat)
+{
+    const bool bc3 = vkFormat == Ktx2FormatBc3Unorm;
+    const uint32_t sampleCount = bc3 ? 2 : 1;
+    const uint32_t blockSize = 24 + 16 * sampleCount;
+
+    vector<uint32_t> words = {
+        4 + blockSize,                                  // total size of the descriptor
+        0,                                              // Khronos vendor, basic descriptor type
+        2 | (blockSize << 16),                          // version 2 and the block size
+        (bc3 ? DF_MODEL_BC3 : DF_MODEL_BC1A) | (DF_PRIMARIES_BT709 << 8) | (DF_TRANSFER_LINEAR << 16),
+        3 | (3 << 8),                                   // 4 x 4 texel blocks, stored less one
+        UKtx2BlockSize(vkFormat), 0                     // bytes per block in the only plane
+    };
+
+    // bit offset, bit length less one and channel, then the sample position and the lower and upper values
+    if (bc3) {
+        words.insert(words.end(), { 0 | (63 << 16) | (DF_CHANNEL_BC3_ALPHA << 24), 0, 0, 0xFFFFFFFF });
+        words.insert(words.end(), { 64 | (63 << 16), 0, 0, 0xFFFFFFFF });
+    }
+    else {
+        words.insert(words.end(), { 0 | (63 << 16), 0, 0, 0xFFFFFFFF });
+    }
+
+    UAppend(file, words.data(), words.size() * sizeof(uint32_t));
+}
+
+// one key and value entry, both null terminated and padded to 4 bytes
+void UAppendKeyValue(vector<unsigned char>& file, const string& key, const string& value)
+{
+    uint32_t length = (uint32_t)(key.size() + 1 + value.size() + 1);
+
+    UAppend(file, &length, sizeof(length));
+    UAppend(file, key.c_str(), key.size() + 1);
+    UAppend(file, value.c_str(), value.size() + 1);
+    file.resize((file.size() + 3) / 4 * 4);
+}